@@ -0,0 +1,567 @@
+#ifndef CPP_EX3_AHOCORASICK_HPP
+#define CPP_EX3_AHOCORASICK_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HashMap.hpp"
+#include "IntHashMap.hpp"
+#include "FrozenHashMap.hpp"
+
+#define AC_ROOT 0
+#define AC_NONE -1
+#define AC_MAGIC "HMAUTOMA"
+#define AC_VERSION 1
+#define AC_EMPTY_EDGE 0xFFFFFFFFU
+#define AC_MAX_STATES ((1 << 24) - 1)
+
+/**
+ * Aho-Corasick automaton over a set of phrases with int values. Feeding a text
+ * one char at a time through step() visits every occurrence of every phrase
+ * in a single pass: after each char, forEachMatch() lists the phrases ending
+ * there, so scanning a text costs O(text length + occurrences) no matter how
+ * many phrases there are.
+ *
+ * States are the prefixes of the phrases. The failure link of a state leads
+ * to its longest proper suffix that is also a state, and the output link to
+ * the longest such suffix that is a whole phrase. The edges of all states
+ * live in a single open addressing table keyed by (state << 8 | char), which
+ * limits the automaton to AC_MAX_STATES states: one less than the 24 bits
+ * allow, so that no key is AC_EMPTY_EDGE.
+ *
+ * A built automaton can be written to a file as a position independent image
+ * and mapped back without building it again, see freeze(). Mapping only
+ * checks the image in one linear pass. Layout, in host byte order:
+ *   Header
+ *   State[stateAmt]
+ *   Edge[edgeCapacity]    linear probing, load <= 0.5
+ */
+class AhoCorasick
+{
+	/**
+	 * Image header
+	 */
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t endianTag;
+		uint64_t stateAmt;
+		uint64_t edgeCapacity;
+		uint64_t statesOffset;
+		uint64_t edgesOffset;
+	};
+
+	/**
+	 * A prefix of some phrase
+	 */
+	struct State
+	{
+		int32_t fail;
+		int32_t output;
+		int32_t value;
+		uint32_t depth : 31;
+		uint32_t isPhrase : 1;
+	};
+
+	/**
+	 * Table slot, key is AC_EMPTY_EDGE for empty slots
+	 */
+	struct Edge
+	{
+		uint32_t key;
+		int32_t target;
+	};
+
+public:
+	/**
+	 * Constructor that compiles the phrases of a map
+	 * @param phrases any map whose iteration yields pairs of string and int
+	 */
+	template <class Map, class = decltype(std::declval<const Map&>().begin())>
+	explicit AhoCorasick(const Map &phrases):
+			_base(nullptr),
+			_bytes(0),
+			_bMapped(false)
+	{
+		/* Trie edges are collected in a growable map first, then laid out */
+		IntHashMap<uint32_t, int> edges;
+		vector<int> parents(1, AC_NONE);
+		vector<unsigned char> letters(1, 0);
+		_ownedStates.push_back(State{AC_ROOT, AC_NONE, 0, 0, false});
+		for(auto it = phrases.begin(); it != phrases.end(); ++it)
+		{
+			_addPhrase(edges, parents, letters, it -> first, it -> second);
+		}
+
+		_layEdges(edges);
+		_states = _ownedStates.data();
+		_iStateAmt = _ownedStates.size();
+		_link(parents, letters);
+	}
+
+	/**
+	 * Constructor that views an image already in memory, which must outlive
+	 * this automaton. Throws invalidImageException if the bytes are not an
+	 * image
+	 * @param data start of the image, aligned to 8 bytes
+	 * @param bytes size of the image
+	 */
+	AhoCorasick(const void *data, size_t bytes):
+			_base(static_cast<const char*>(data)),
+			_bytes(bytes),
+			_bMapped(false)
+	{
+		_validate();
+	}
+
+	/**
+	 * Constructor that maps an image file written by writeFile() read only.
+	 * Throws invalidImageException if the file can't be mapped or is not an
+	 * image
+	 * @param fileName path of the image
+	 */
+	explicit AhoCorasick(const std::string &fileName):
+			_base(nullptr),
+			_bytes(0),
+			_bMapped(true)
+	{
+		int fd = open(fileName.c_str(), O_RDONLY);
+		if(fd < 0)
+		{
+			throw invalidImageException("Can't open image file");
+		}
+
+		struct stat info;
+		if(fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			close(fd);
+			throw invalidImageException("Can't read image file");
+		}
+
+		void *addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(addr == MAP_FAILED)
+		{
+			throw invalidImageException("Can't map image file");
+		}
+
+		_base = static_cast<const char*>(addr);
+		_bytes = info.st_size;
+
+		try
+		{
+			_validate();
+		}
+		catch(const invalidImageException &)
+		{
+			munmap(const_cast<char*>(_base), _bytes);
+			throw;
+		}
+	}
+
+	AhoCorasick(const AhoCorasick &other) = delete;
+
+	AhoCorasick& operator=(const AhoCorasick &other) = delete;
+
+	/**
+	 * Move constructor, takes over the states and edges of other
+	 * @param other
+	 */
+	AhoCorasick(AhoCorasick &&other) noexcept:
+			_base(other._base),
+			_bytes(other._bytes),
+			_bMapped(other._bMapped),
+			_ownedStates(std::move(other._ownedStates)),
+			_ownedEdges(std::move(other._ownedEdges)),
+			_states(other._states),
+			_edges(other._edges),
+			_iStateAmt(other._iStateAmt),
+			_iEdgeMask(other._iEdgeMask)
+	{
+		other._bMapped = false;
+	}
+
+	/**
+	 * Destructor, unmaps the image if this automaton mapped it
+	 */
+	~AhoCorasick()
+	{
+		if(_bMapped)
+		{
+			munmap(const_cast<char*>(_base), _bytes);
+		}
+	}
+
+	/**
+	 * Check if a file starts with the header of an image written by writeFile()
+	 * @param fileName path of the file
+	 * @return true if it does, otherwise false
+	 */
+	static bool isImageFile(const std::string &fileName)
+	{
+		Header header;
+		std::ifstream file(fileName, std::ios::binary);
+		file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+		return file && std::memcmp(header.magic, AC_MAGIC, sizeof(header.magic)) == 0 &&
+		       header.version == AC_VERSION && header.endianTag == FROZEN_ENDIAN_TAG;
+	}
+
+	/**
+	 * Build the image of the automaton
+	 * @return the bytes of the image
+	 */
+	std::string freeze() const
+	{
+		Header header;
+		std::memcpy(header.magic, AC_MAGIC, sizeof(header.magic));
+		header.version = AC_VERSION;
+		header.endianTag = FROZEN_ENDIAN_TAG;
+		header.stateAmt = _iStateAmt;
+		header.edgeCapacity = _iEdgeMask + 1;
+		header.statesOffset = sizeof(Header);
+		header.edgesOffset = sizeof(Header) + _iStateAmt * sizeof(State);
+
+		std::string image(header.edgesOffset + header.edgeCapacity * sizeof(Edge), '\0');
+		std::memcpy(&image[0], &header, sizeof(Header));
+		std::memcpy(&image[header.statesOffset], _states, _iStateAmt * sizeof(State));
+		std::memcpy(&image[header.edgesOffset], _edges, header.edgeCapacity * sizeof(Edge));
+		return image;
+	}
+
+	/**
+	 * Write the image of the automaton to a file
+	 * @param fileName path to write to
+	 * @return true if written, otherwise false
+	 */
+	bool writeFile(const std::string &fileName) const
+	{
+		std::string image = freeze();
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		file.write(image.data(), image.size());
+		return (bool) file;
+	}
+
+	/**
+	 * Get amount of states in the automaton
+	 * @return
+	 */
+	int size() const
+	{
+		return (int) _iStateAmt;
+	}
+
+	/**
+	 * Get the state before any char was fed
+	 * @return
+	 */
+	static int start()
+	{
+		return AC_ROOT;
+	}
+
+	/**
+	 * Feed a char to the automaton
+	 * @param state current state
+	 * @param letter next char of the text
+	 * @return state after letter, the state of the longest suffix of the text
+	 * read so far that is a prefix of some phrase
+	 */
+	int step(int state, char letter) const
+	{
+		while(true)
+		{
+			int next = _target(state, letter);
+			if(next != AC_NONE)
+			{
+				return next;
+			}
+
+			if(state == AC_ROOT)
+			{
+				return AC_ROOT;
+			}
+
+			state = _states[state].fail;
+		}
+	}
+
+	/**
+	 * Call fn on every phrase ending at the last char fed, longest first
+	 * @param state current state
+	 * @param fn callable taking the length and the value of a phrase
+	 */
+	template <class F>
+	void forEachMatch(int state, F fn) const
+	{
+		int match = _states[state].isPhrase ? state : _states[state].output;
+		while(match != AC_NONE)
+		{
+			fn(_states[match].depth, _states[match].value);
+			match = _states[match].output;
+		}
+	}
+
+	/**
+	 * Look up a whole phrase, without scanning
+	 * @param phrase phrase to look up
+	 * @return pointer to the value of phrase, or nullptr if not a phrase
+	 */
+	const int* find(std::string_view phrase) const
+	{
+		int state = AC_ROOT;
+		for(char letter: phrase)
+		{
+			state = _target(state, letter);
+			if(state == AC_NONE)
+			{
+				return nullptr;
+			}
+		}
+
+		return _states[state].isPhrase ? &_states[state].value : nullptr;
+	}
+
+private:
+	/**
+	 * Get the key of the edge leaving state by letter
+	 * @param state
+	 * @param letter
+	 * @return
+	 */
+	static uint32_t _edgeKey(int state, char letter)
+	{
+		static_assert(((uint32_t) (AC_MAX_STATES - 1) << 8 | 0xFF) != AC_EMPTY_EDGE,
+		              "The last state can't have an edge keyed AC_EMPTY_EDGE");
+		return ((uint32_t) state << 8) | (unsigned char) letter;
+	}
+
+	/**
+	 * Follow the edge leaving state by letter
+	 * @param state
+	 * @param letter
+	 * @return the state the edge leads to, AC_NONE if there is no such edge
+	 */
+	int _target(int state, char letter) const
+	{
+		uint32_t key = _edgeKey(state, letter);
+		for(uint64_t idx = mixInteger(key) & _iEdgeMask;; idx = (idx + 1) & _iEdgeMask)
+		{
+			if(_edges[idx].key == key)
+			{
+				return _edges[idx].target;
+			}
+
+			if(_edges[idx].key == AC_EMPTY_EDGE)
+			{
+				return AC_NONE;
+			}
+		}
+	}
+
+	/**
+	 * Add the states of a phrase. A phrase seen before keeps its first value,
+	 * as HashMap::insert() does
+	 * @param edges trie edges so far
+	 * @param parents parent of every state
+	 * @param letters letter of the edge into every state
+	 * @param phrase
+	 * @param value
+	 */
+	void _addPhrase(IntHashMap<uint32_t, int> &edges, vector<int> &parents, vector<unsigned char> &letters,
+	                std::string_view phrase, int value)
+	{
+		int state = AC_ROOT;
+		for(char letter: phrase)
+		{
+			std::pair<int*, bool> edge = edges.try_emplace(_edgeKey(state, letter), (int) _ownedStates.size());
+			if(edge.second)
+			{
+				if(_ownedStates.size() == AC_MAX_STATES)
+				{
+					throw std::length_error("Too many phrase prefixes");
+				}
+
+				_ownedStates.push_back(State{AC_ROOT, AC_NONE, 0, (uint32_t) _ownedStates[state].depth + 1, false});
+				parents.push_back(state);
+				letters.push_back((unsigned char) letter);
+			}
+
+			state = *edge.first;
+		}
+
+		if(!_ownedStates[state].isPhrase)
+		{
+			_ownedStates[state].isPhrase = true;
+			_ownedStates[state].value = value;
+		}
+	}
+
+	/**
+	 * Lay the trie edges out in the probing table
+	 * @param edges trie edges
+	 */
+	void _layEdges(const IntHashMap<uint32_t, int> &edges)
+	{
+		uint64_t capacity = DEF_CAP;
+		while(capacity < 2 * (uint64_t) edges.size())
+		{
+			capacity *= 2;
+		}
+
+		_ownedEdges.assign(capacity, Edge{AC_EMPTY_EDGE, AC_NONE});
+		for(auto it = edges.begin(); it != edges.end(); ++it)
+		{
+			uint64_t idx = mixInteger(it -> first) & (capacity - 1);
+			while(_ownedEdges[idx].key != AC_EMPTY_EDGE)
+			{
+				idx = (idx + 1) & (capacity - 1);
+			}
+
+			_ownedEdges[idx] = Edge{it -> first, it -> second};
+		}
+
+		_edges = _ownedEdges.data();
+		_iEdgeMask = capacity - 1;
+	}
+
+	/**
+	 * Set the failure and output links of every state. A link always leads
+	 * to a shallower state, so states are linked in order of depth
+	 * @param parents parent of every state
+	 * @param letters letter of the edge into every state
+	 */
+	void _link(const vector<int> &parents, const vector<unsigned char> &letters)
+	{
+		vector<int> byDepth(_iStateAmt);
+		vector<int> depthStart(_iStateAmt + 1, 0);
+		for(const State &state: _ownedStates)
+		{
+			depthStart[state.depth + 1]++;
+		}
+
+		for(size_t depth = 1; depth < depthStart.size(); ++depth)
+		{
+			depthStart[depth] += depthStart[depth - 1];
+		}
+
+		for(size_t i = 0; i < _iStateAmt; ++i)
+		{
+			byDepth[depthStart[_ownedStates[i].depth]++] = (int) i;
+		}
+
+		for(int idx: byDepth)
+		{
+			State &state = _ownedStates[idx];
+			if(state.depth <= 1)
+			{
+				continue;
+			}
+
+			state.fail = step(_ownedStates[parents[idx]].fail, (char) letters[idx]);
+			const State &fail = _ownedStates[state.fail];
+			state.output = fail.isPhrase ? state.fail : fail.output;
+		}
+	}
+
+	/**
+	 * Check the image against its size and set up the pointers into it.
+	 * Sizes are compared before they are multiplied, so a crafted capacity
+	 * can't wrap around, and every link and edge is checked to lead to a
+	 * state, so a damaged image can't send a scan out of bounds
+	 */
+	void _validate()
+	{
+		if(_bytes < sizeof(Header) || ((uintptr_t) _base % alignof(Header)) != 0)
+		{
+			throw invalidImageException("Image too small or misaligned");
+		}
+
+		const Header *header = reinterpret_cast<const Header*>(_base);
+		if(std::memcmp(header -> magic, AC_MAGIC, sizeof(header -> magic)) != 0 ||
+		   header -> version != AC_VERSION ||
+		   header -> endianTag != FROZEN_ENDIAN_TAG)
+		{
+			throw invalidImageException("Not an automaton image");
+		}
+
+		uint64_t stateAmt = header -> stateAmt;
+		uint64_t capacity = header -> edgeCapacity;
+		if(stateAmt == 0 || stateAmt > AC_MAX_STATES ||
+		   capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+		   header -> statesOffset != sizeof(Header) ||
+		   header -> edgesOffset != sizeof(Header) + stateAmt * sizeof(State) ||
+		   header -> edgesOffset > _bytes ||
+		   capacity > (_bytes - header -> edgesOffset) / sizeof(Edge) ||
+		   capacity * sizeof(Edge) != _bytes - header -> edgesOffset)
+		{
+			throw invalidImageException("Corrupt automaton image");
+		}
+
+		_states = reinterpret_cast<const State*>(_base + header -> statesOffset);
+		_edges = reinterpret_cast<const Edge*>(_base + header -> edgesOffset);
+		_iStateAmt = stateAmt;
+		_iEdgeMask = capacity - 1;
+
+		if(_states[AC_ROOT].depth != 0 || _states[AC_ROOT].output != AC_NONE)
+		{
+			throw invalidImageException("Corrupt automaton image");
+		}
+
+		/* Links lead to shallower states and edges one level deeper, so no
+		 * walk can loop and no match is longer than the text read */
+		for(uint64_t i = 1; i < stateAmt; ++i)
+		{
+			const State &state = _states[i];
+			if(state.fail < 0 || (uint64_t) state.fail >= stateAmt ||
+			   state.output < AC_NONE || state.output >= (int64_t) stateAmt ||
+			   _states[state.fail].depth >= state.depth ||
+			   (state.output != AC_NONE && _states[state.output].depth >= state.depth))
+			{
+				throw invalidImageException("Corrupt automaton image");
+			}
+		}
+
+		bool hasEmpty = false;
+		for(uint64_t i = 0; i < capacity; ++i)
+		{
+			const Edge &edge = _edges[i];
+			if(edge.key == AC_EMPTY_EDGE)
+			{
+				hasEmpty = true;
+				continue;
+			}
+
+			if((edge.key >> 8) >= stateAmt || edge.target <= 0 || (uint64_t) edge.target >= stateAmt ||
+			   _states[edge.target].depth != (int64_t) _states[edge.key >> 8].depth + 1)
+			{
+				throw invalidImageException("Corrupt automaton image");
+			}
+		}
+
+		if(!hasEmpty)
+		{
+			throw invalidImageException("Corrupt automaton image");
+		}
+	}
+
+	const char *_base;
+	size_t _bytes;
+	bool _bMapped;
+	vector<State> _ownedStates;
+	vector<Edge> _ownedEdges;
+	const State *_states;
+	const Edge *_edges;
+	size_t _iStateAmt;
+	uint64_t _iEdgeMask;
+};
+
+#endif //CPP_EX3_AHOCORASICK_HPP
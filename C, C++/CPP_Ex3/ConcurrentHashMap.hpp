@@ -0,0 +1,312 @@
+#ifndef CPP_EX3_CONCURRENTHASHMAP_HPP
+#define CPP_EX3_CONCURRENTHASHMAP_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include "HashMap.hpp"
+
+#define DEF_SHARDS 16
+#define CACHE_LINE 64
+
+/**
+ * Thread safe companion to HashMap. The key space is split into a power of two
+ * amount of shards by the high bits of the key hash, every shard is a HashMap
+ * guarded by its own reader/writer lock. Readers of a shard run in parallel
+ * with each other, and writers only block the shard they write to.
+ * Accessors return values by copy, since a reference into a shard would
+ * outlive its lock
+ * @tparam KeyT type of key
+ * @tparam ValueT type of value
+ * @tparam Hash hash functor for keys
+ * @tparam KeyEqual equality functor for keys
+ */
+template <class KeyT, class ValueT, class Hash = KeyHash<KeyT>, class KeyEqual = std::equal_to<>>
+class ConcurrentHashMap
+{
+	typedef HashMap<KeyT, ValueT, Hash, KeyEqual> Map;
+
+	/**
+	 * A single shard, aligned to a cache line so locks of neighbouring
+	 * shards don't share one
+	 */
+	struct alignas(CACHE_LINE) Shard
+	{
+		mutable std::shared_mutex lock;
+		Map map;
+	};
+
+	/**
+	 * Enables the lookup overloads taking a key of type K other than KeyT,
+	 * only available when both the hash and the equality are transparent
+	 */
+	template <class K>
+	using heterogeneousKey = typename std::enable_if<isTransparent<Hash>::value &&
+	                                                 isTransparent<KeyEqual>::value &&
+	                                                 !std::is_same<K, KeyT>::value, int>::type;
+
+public:
+	/**
+	 * Constructor that receives the amount of shards
+	 * @param shardAmt amount of shards, rounded up to a power of two
+	 */
+	explicit ConcurrentHashMap(int shardAmt = DEF_SHARDS): _iShardBits(0)
+	{
+		while((1 << _iShardBits) < shardAmt)
+		{
+			++_iShardBits;
+		}
+
+		_iShardAmt = 1 << _iShardBits;
+		_shards = new Shard[_iShardAmt];
+	}
+
+	ConcurrentHashMap(const ConcurrentHashMap &other) = delete;
+
+	ConcurrentHashMap& operator=(const ConcurrentHashMap &other) = delete;
+
+	/**
+	 * Destructor
+	 */
+	~ConcurrentHashMap()
+	{
+		delete[] _shards;
+	}
+
+	/**
+	 * Get amount of shards
+	 * @return
+	 */
+	int shardAmount() const
+	{
+		return _iShardAmt;
+	}
+
+	/**
+	 * Get amount of pairs in the map. Shards are counted one after the other,
+	 * so the result may be stale by the time it returns under concurrent writes
+	 * @return
+	 */
+	int size() const
+	{
+		int size = 0;
+		for(int i = 0; i < _iShardAmt; ++i)
+		{
+			std::shared_lock<std::shared_mutex> guard(_shards[i].lock);
+			size += _shards[i].map.size();
+		}
+
+		return size;
+	}
+
+	/**
+	 * Check if map is empty, see size()
+	 * @return true if empty, otherwise false
+	 */
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * Check if map contains given key
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool containsKey(const KeyT &key) const
+	{
+		return _containsKey(key);
+	}
+
+	/**
+	 * Check if map contains a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool containsKey(const K &key) const
+	{
+		return _containsKey(key);
+	}
+
+	/**
+	 * Copy the value bound to key into value
+	 * @param key key to look up
+	 * @param value set to the value bound to key if it is present
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool get(const KeyT &key, ValueT &value) const
+	{
+		return _get(key, value);
+	}
+
+	/**
+	 * Copy the value bound to a key equal to key into value
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @param value set to the value bound to key if it is present
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool get(const K &key, ValueT &value) const
+	{
+		return _get(key, value);
+	}
+
+	/**
+	 * Get value at key in map. Throws exception if key not present
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
+	 */
+	ValueT at(const KeyT &key) const
+	{
+		const Shard &shard = _shardOf(key);
+		std::shared_lock<std::shared_mutex> guard(shard.lock);
+		return shard.map.at(key);
+	}
+
+	/**
+	 * Insert given item to map
+	 * @param key key of item
+	 * @param value value of item
+	 * @return true if successfully inserted, false if key was already present
+	 */
+	bool insert(KeyT key, ValueT value)
+	{
+		Shard &shard = _shardOf(key);
+		std::unique_lock<std::shared_mutex> guard(shard.lock);
+		return shard.map.insert(std::move(key), std::move(value));
+	}
+
+	/**
+	 * Atomically bind value to key, overwriting the current value if key is present
+	 * @param key key to assign
+	 * @param value value to bind
+	 * @return true if key was inserted, false if an existing value was assigned
+	 */
+	bool upsert(const KeyT &key, const ValueT &value)
+	{
+		Shard &shard = _shardOf(key);
+		std::unique_lock<std::shared_mutex> guard(shard.lock);
+		return shard.map.insert_or_assign(key, value);
+	}
+
+	/**
+	 * Atomically add delta to the value bound to key. A missing key is
+	 * inserted with a value initialized ValueT before the addition
+	 * @param key key of the counter
+	 * @param delta amount to add
+	 * @return value bound to key before the addition
+	 */
+	ValueT fetch_add(const KeyT &key, const ValueT &delta)
+	{
+		Shard &shard = _shardOf(key);
+		std::unique_lock<std::shared_mutex> guard(shard.lock);
+		ValueT &value = *shard.map.try_emplace(key).first;
+		ValueT previous = value;
+		value += delta;
+		return previous;
+	}
+
+	/**
+	 * Erase value bound to key
+	 * @param key key to look up
+	 * @return true if value successfully erased, otherwise false
+	 */
+	bool erase(const KeyT &key)
+	{
+		Shard &shard = _shardOf(key);
+		std::unique_lock<std::shared_mutex> guard(shard.lock);
+		return shard.map.erase(key);
+	}
+
+	/**
+	 * Erase all pairs from map
+	 */
+	void clear()
+	{
+		for(int i = 0; i < _iShardAmt; ++i)
+		{
+			std::unique_lock<std::shared_mutex> guard(_shards[i].lock);
+			_shards[i].map.clear();
+		}
+	}
+
+	/**
+	 * Call fn on every pair in the map. Each shard is locked for reading while
+	 * fn runs on its pairs, so fn must not write to this map
+	 * @param fn callable taking a const pair<KeyT, ValueT>&
+	 */
+	template <class F>
+	void forEach(F fn) const
+	{
+		for(int i = 0; i < _iShardAmt; ++i)
+		{
+			std::shared_lock<std::shared_mutex> guard(_shards[i].lock);
+			for(auto it = _shards[i].map.begin(); it != _shards[i].map.end(); ++it)
+			{
+				fn(*it);
+			}
+		}
+	}
+
+private:
+	/**
+	 * Pick the shard of a key from the high bits of its hash. The shard maps
+	 * index their buckets by the low bits, so the two don't correlate; the
+	 * hash is mixed first since std::hash is the identity for integers
+	 * @param key key to look up
+	 * @return
+	 */
+	template <class K>
+	Shard& _shardOf(const K &key) const
+	{
+		if(_iShardBits == 0)
+		{
+			return _shards[0];
+		}
+
+		uint64_t hash = (uint64_t) _hasher(key) * 0x9E3779B97F4A7C15ULL;
+		return _shards[hash >> (64 - _iShardBits)];
+	}
+
+	/**
+	 * Shared implementation of containsKey()
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K>
+	bool _containsKey(const K &key) const
+	{
+		const Shard &shard = _shardOf(key);
+		std::shared_lock<std::shared_mutex> guard(shard.lock);
+		return shard.map.containsKey(key);
+	}
+
+	/**
+	 * Shared implementation of get()
+	 * @param key key to look up
+	 * @param value set to the value bound to key if it is present
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K>
+	bool _get(const K &key, ValueT &value) const
+	{
+		const Shard &shard = _shardOf(key);
+		std::shared_lock<std::shared_mutex> guard(shard.lock);
+		const ValueT *found = shard.map.find(key);
+		if(found == nullptr)
+		{
+			return false;
+		}
+
+		value = *found;
+		return true;
+	}
+
+	Hash _hasher;
+	int _iShardBits;
+	int _iShardAmt;
+	Shard *_shards;
+};
+
+#endif //CPP_EX3_CONCURRENTHASHMAP_HPP
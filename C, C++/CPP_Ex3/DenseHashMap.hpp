@@ -0,0 +1,703 @@
+#ifndef CPP_EX3_DENSEHASHMAP_HPP
+#define CPP_EX3_DENSEHASHMAP_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "HashMap.hpp"
+
+#define DENSE_EMPTY -1
+
+/**
+ * HashMap with a compact layout, in the spirit of the compact dicts of Python.
+ * All pairs live back to back in one dense vector, in insertion order until
+ * something is erased, and a separate table of 32 bit positions into that
+ * vector is probed linearly. Iteration is a scan of the dense vector that
+ * yields references, and a rehash only rebuilds the position table, since
+ * the hash of every pair is kept next to the pairs. erase() moves the last
+ * pair into the hole, so the vector stays dense. The public API mirrors
+ * HashMap so the two can be swapped for each other.
+ * @tparam KeyT type of key
+ * @tparam ValueT type of value
+ * @tparam Hash hash functor for keys
+ * @tparam KeyEqual equality functor for keys
+ */
+template <class KeyT, class ValueT, class Hash = KeyHash<KeyT>, class KeyEqual = std::equal_to<>>
+class DenseHashMap
+{
+	/**
+	 * Enables the lookup overloads taking a key of type K other than KeyT,
+	 * only available when both the hash and the equality are transparent
+	 */
+	template <class K>
+	using heterogeneousKey = typename std::enable_if<isTransparent<Hash>::value &&
+	                                                 isTransparent<KeyEqual>::value &&
+	                                                 !std::is_same<K, KeyT>::value, int>::type;
+
+public:
+	typedef pair<KeyT, ValueT> value_type;
+	typedef typename vector<value_type>::const_iterator const_iterator;
+
+	/**
+	 * Constructor that receives upper and lower load factors
+	 * @param dLower lower bound
+	 * @param dUpper upper bound
+	 */
+	DenseHashMap(double dLower, double dUpper):
+			_dLower(dLower),
+			_dUpper(dUpper),
+			_index(DEF_CAP, DENSE_EMPTY)
+	{
+	}
+
+	/**
+	 * Default constructor, empty map with fUpper = 0.75 and fLower = 0.25
+	 */
+	DenseHashMap(): DenseHashMap(DEF_LOWER, DEF_UPPER) {}
+
+	/**
+	 * Constructor that receives a key vector and a value vector,
+	 * creates map of keys and values with corresponding indices
+	 * @param keyVec vector of keys
+	 * @param valVec vector of values
+	 */
+	DenseHashMap(const vector<KeyT> &keyVec, const vector<ValueT> &valVec): DenseHashMap()
+	{
+		if(keyVec.size() != valVec.size())
+		{
+			throw differentVectorSizes("Vectors are of different sizes");
+		}
+
+		reserve((int) keyVec.size());
+		for(unsigned long i = 0; i < keyVec.size(); ++i)
+		{
+			insert(keyVec[i], valVec[i]);
+		}
+	}
+
+	/**
+	 * Get amount of cells currently occupied
+	 * @return
+	 */
+	int size() const
+	{
+		return (int) _entries.size();
+	}
+
+	/**
+	 * Get the size of the position table
+	 * @return
+	 */
+	int capacity() const
+	{
+		return (int) _index.size();
+	}
+
+	/**
+	 * Get current load factor (size / capacity)
+	 * @return
+	 */
+	double getLoadFactor() const
+	{
+		return _index.empty() ? 0 : (double) _entries.size() / _index.size();
+	}
+
+	/**
+	 * Check if map is empty
+	 * @return true if empty, otherwise false
+	 */
+	bool empty() const
+	{
+		return _entries.empty();
+	}
+
+	/**
+	 * Get the pairs of the map as one contiguous vector, e.g. for exporting
+	 * the whole table
+	 * @return
+	 */
+	const vector<value_type>& entries() const
+	{
+		return _entries;
+	}
+
+	/**
+	 * Check if map contains given key
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool containsKey(const KeyT &key) const
+	{
+		return _find(key, _hash(key)) >= 0;
+	}
+
+	/**
+	 * Check if map contains a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool containsKey(const K &key) const
+	{
+		return _find(key, _hash(key)) >= 0;
+	}
+
+	/**
+	 * Look up the value bound to key
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present. The pointer
+	 * is invalidated by any later insertion or erasure
+	 */
+	ValueT* find(const KeyT &key)
+	{
+		long slot = _find(key, _hash(key));
+		return slot < 0 ? nullptr : &_entries[_index[slot]].second;
+	}
+
+	/**
+	 * Look up the value bound to key
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	const ValueT* find(const KeyT &key) const
+	{
+		long slot = _find(key, _hash(key));
+		return slot < 0 ? nullptr : &_entries[_index[slot]].second;
+	}
+
+	/**
+	 * Look up the value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	ValueT* find(const K &key)
+	{
+		long slot = _find(key, _hash(key));
+		return slot < 0 ? nullptr : &_entries[_index[slot]].second;
+	}
+
+	/**
+	 * Look up the value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	const ValueT* find(const K &key) const
+	{
+		long slot = _find(key, _hash(key));
+		return slot < 0 ? nullptr : &_entries[_index[slot]].second;
+	}
+
+	/**
+	 * Rebuild the position table with capacity multiplied by factor
+	 * @param factor factor by which to resize
+	 */
+	void resize(double factor)
+	{
+		_rehash((int) (_index.size() * factor));
+	}
+
+	/**
+	 * Make room for at least n pairs without rehashing on the way
+	 * @param n amount of pairs
+	 */
+	void reserve(int n)
+	{
+		_entries.reserve(n);
+		_hashes.reserve(n);
+
+		size_t cap = _index.empty() ? DEF_CAP : _index.size();
+		while(n >= cap * _dUpper)
+		{
+			cap *= 2;
+		}
+
+		if(cap != _index.size())
+		{
+			_rehash((int) cap);
+		}
+	}
+
+	/**
+	 * Insert given item to map
+	 * @param key key of item
+	 * @param value value of item
+	 * @return true if successfully inserted, otherwise false
+	 */
+	bool insert(KeyT key, ValueT value)
+	{
+		return try_emplace(std::move(key), std::move(value)).second;
+	}
+
+	/**
+	 * Insert given pair to map, moving it to the end of the dense vector
+	 * @param item item to be inserted
+	 * @return true if successfully inserted, otherwise false
+	 */
+	bool insert(value_type &&item)
+	{
+		size_t hash = _hash(item.first);
+		if(_find(item.first, hash) >= 0)
+		{
+			return false;
+		}
+
+		_emplaceNew(hash, std::move(item));
+		return true;
+	}
+
+	/**
+	 * Construct a pair from args and insert it if its key is not present.
+	 * Prefer try_emplace() when the key is at hand, since it does not build
+	 * the value for keys that are already present
+	 * @param args arguments forwarded to the constructor of value_type
+	 * @return pointer to the value bound to the key and true if it was
+	 * inserted, false if the key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> emplace(Args&&... args)
+	{
+		value_type item(std::forward<Args>(args)...);
+		size_t hash = _hash(item.first);
+		long slot = _find(item.first, hash);
+		if(slot >= 0)
+		{
+			return pair<ValueT*, bool>(&_entries[_index[slot]].second, false);
+		}
+
+		return pair<ValueT*, bool>(&_emplaceNew(hash, std::move(item)).second, true);
+	}
+
+	/**
+	 * Insert a value constructed from args if key is not present, otherwise
+	 * leave the map untouched. Hashes key and probes once
+	 * @param key key to look up
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and true if it was inserted,
+	 * false if key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> try_emplace(const KeyT &key, Args&&... args)
+	{
+		return _tryEmplace(key, std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Same as try_emplace(const KeyT&, Args&&...), but moves key into the map
+	 * if it is inserted
+	 * @param key key to look up
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and true if it was inserted,
+	 * false if key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> try_emplace(KeyT &&key, Args&&... args)
+	{
+		return _tryEmplace(std::move(key), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Bind value to key, overwriting the current value if key is present
+	 * @param key key to assign
+	 * @param value value to bind
+	 * @return true if key was inserted, false if an existing value was assigned
+	 */
+	bool insert_or_assign(const KeyT &key, const ValueT &value)
+	{
+		pair<ValueT*, bool> result = try_emplace(key, value);
+		if(!result.second)
+		{
+			*result.first = value;
+		}
+
+		return result.second;
+	}
+
+	/**
+	 * Get value at key in map. Throws exception if key not present
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
+	 */
+	ValueT at(const KeyT &key) const
+	{
+		return _entries[_findOrThrow(key)].second;
+	}
+
+	/**
+	 * Get value at a key equal to key, without converting it to KeyT. Throws
+	 * exception if key not present
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return value bound to key, or exception if key not found
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	ValueT at(const K &key) const
+	{
+		return _entries[_findOrThrow(key)].second;
+	}
+
+	/**
+	 * Erase value bound to key
+	 * @param key key to look up
+	 * @return true if value successfully erased, otherwise false
+	 */
+	bool erase(const KeyT &key)
+	{
+		return _eraseAt(_find(key, _hash(key)));
+	}
+
+	/**
+	 * Erase value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if value successfully erased, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool erase(const K &key)
+	{
+		return _eraseAt(_find(key, _hash(key)));
+	}
+
+	/**
+	 * Get the length of the probe run the key hashes into, the open
+	 * addressing counterpart of HashMap::bucketSize()
+	 * @param key key to look up
+	 * @return
+	 */
+	int bucketSize(const KeyT &key) const
+	{
+		if(_index.empty())
+		{
+			return 0;
+		}
+
+		size_t mask = _index.size() - 1;
+		int count = 0;
+		for(size_t slot = _hash(key) & mask; _index[slot] != DENSE_EMPTY; slot = (slot + 1) & mask)
+		{
+			++count;
+		}
+
+		return count;
+	}
+
+	/**
+	 * Erase all pairs from map, keeps the current capacity
+	 */
+	void clear()
+	{
+		_entries.clear();
+		_hashes.clear();
+		_index.assign(_index.size(), DENSE_EMPTY);
+	}
+
+	/**
+	 * Overload for [] operator, returns value corresponding to given key.
+	 * Throws exception if key not present
+	 * @param key key to look up
+	 * @return value attached to key
+	 */
+	const ValueT& operator[](const KeyT &key) const
+	{
+		return _entries[_findOrThrow(key)].second;
+	}
+
+	/**
+	 * Overload for [] operator, creates new pair if key not present
+	 * @param key key to assign
+	 * @return reference to value
+	 */
+	ValueT& operator[](const KeyT &key)
+	{
+		return *try_emplace(key).first;
+	}
+
+	/**
+	 * Overload for == operator, checks that all fields are equal. Walks the
+	 * dense vector of other and probes this map once per pair
+	 * @param other map to compare to
+	 * @return true if all fields are equal, otherwise false
+	 */
+	bool operator==(const DenseHashMap &other) const
+	{
+		if(_entries.size() != other._entries.size() ||
+		   _index.size() != other._index.size() ||
+		   _dUpper != other._dUpper ||
+		   _dLower != other._dLower)
+		{
+			return false;
+		}
+
+		for(size_t i = 0; i < other._entries.size(); ++i)
+		{
+			long slot = _find(other._entries[i].first, other._hashes[i]);
+			if(slot < 0 || !(_entries[_index[slot]].second == other._entries[i].second))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Overload for != operator
+	 * @param other map to compare to
+	 * @return opposite of ==
+	 */
+	bool operator!=(const DenseHashMap &other) const
+	{
+		return !(operator==(other));
+	}
+
+	/**
+	 * Returns first element in iteration
+	 * @return
+	 */
+	const_iterator begin() const
+	{
+		return _entries.begin();
+	}
+
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator end() const
+	{
+		return _entries.end();
+	}
+
+	/**
+	 * Returns first element in iteration
+	 * @return
+	 */
+	const_iterator cbegin() const
+	{
+		return _entries.cbegin();
+	}
+
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator cend() const
+	{
+		return _entries.cend();
+	}
+
+private:
+	/**
+	 * Hash a key, or anything the hash functor accepts. std::hash is the
+	 * identity for integers, so the result is mixed before it picks a slot
+	 * @param key key to hash
+	 * @return
+	 */
+	template <class K>
+	size_t _hash(const K &key) const
+	{
+		uint64_t hash = _hasher(key);
+		hash ^= hash >> 32;
+		hash *= 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 29;
+		return (size_t) hash;
+	}
+
+	/**
+	 * Find the slot of the position table pointing at key. A moved from map
+	 * has no position table and finds nothing
+	 * @param key key to look up
+	 * @param hash hash of key
+	 * @return slot, or -1 if key not present
+	 */
+	template <class K>
+	long _find(const K &key, size_t hash) const
+	{
+		if(_index.empty())
+		{
+			return -1;
+		}
+
+		size_t mask = _index.size() - 1;
+		for(size_t slot = hash & mask; _index[slot] != DENSE_EMPTY; slot = (slot + 1) & mask)
+		{
+			int32_t pos = _index[slot];
+			if(_hashes[pos] == hash && _keyEqual(_entries[pos].first, key))
+			{
+				return (long) slot;
+			}
+		}
+
+		return -1;
+	}
+
+	/**
+	 * Find the position of key in the dense vector or throw
+	 * @param key key to look up
+	 * @return
+	 */
+	template <class K>
+	int32_t _findOrThrow(const K &key) const
+	{
+		long slot = _find(key, _hash(key));
+		if(slot < 0)
+		{
+			throw invalidKeyException("Key not present in map");
+		}
+
+		return _index[slot];
+	}
+
+	/**
+	 * Point the first empty slot of the probe sequence of hash at pos
+	 * @param hash
+	 * @param pos position in the dense vector
+	 */
+	void _link(size_t hash, int32_t pos)
+	{
+		size_t mask = _index.size() - 1;
+		size_t slot = hash & mask;
+		while(_index[slot] != DENSE_EMPTY)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		_index[slot] = pos;
+	}
+
+	/**
+	 * Append a new pair, growing the position table first if needed
+	 * @param hash hash of the key
+	 * @param args arguments forwarded to the constructor of value_type
+	 * @return the new pair
+	 */
+	template <class... Args>
+	value_type& _emplaceNew(size_t hash, Args&&... args)
+	{
+		if(_entries.size() + 1 > _index.size() * _dUpper)
+		{
+			_rehash((int) (_index.size() * UPPER_FACTOR));
+		}
+
+		_entries.emplace_back(std::forward<Args>(args)...);
+		_hashes.push_back(hash);
+		_link(hash, (int32_t) (_entries.size() - 1));
+		return _entries.back();
+	}
+
+	/**
+	 * Shared implementation of try_emplace()
+	 * @param key key to look up, forwarded into the map if inserted
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return
+	 */
+	template <class K, class... Args>
+	pair<ValueT*, bool> _tryEmplace(K &&key, Args&&... args)
+	{
+		size_t hash = _hash(key);
+		long slot = _find(key, hash);
+		if(slot >= 0)
+		{
+			return pair<ValueT*, bool>(&_entries[_index[slot]].second, false);
+		}
+
+		value_type &item = _emplaceNew(hash, std::piecewise_construct,
+		                               std::forward_as_tuple(std::forward<K>(key)),
+		                               std::forward_as_tuple(std::forward<Args>(args)...));
+		return pair<ValueT*, bool>(&item.second, true);
+	}
+
+	/**
+	 * Erase the pair a slot points at. The slot is closed by shifting the
+	 * rest of its probe run back, and the last pair of the dense vector is
+	 * moved into the hole
+	 * @param slot slot of the position table, -1 for none
+	 * @return true if a pair was erased, otherwise false
+	 */
+	bool _eraseAt(long slot)
+	{
+		if(slot < 0)
+		{
+			return false;
+		}
+
+		int32_t pos = _index[slot];
+		_unlink((size_t) slot);
+
+		int32_t last = (int32_t) _entries.size() - 1;
+		if(pos != last)
+		{
+			size_t mask = _index.size() - 1;
+			size_t lastSlot = _hashes[last] & mask;
+			while(_index[lastSlot] != last)
+			{
+				lastSlot = (lastSlot + 1) & mask;
+			}
+
+			_index[lastSlot] = pos;
+			_entries[pos] = std::move(_entries[last]);
+			_hashes[pos] = _hashes[last];
+		}
+
+		_entries.pop_back();
+		_hashes.pop_back();
+
+		if(_index.size() > DEF_CAP && _entries.size() < _index.size() * _dLower)
+		{
+			_rehash((int) (_index.size() * LOWER_FACTOR));
+		}
+
+		return true;
+	}
+
+	/**
+	 * Empty a slot of the position table without leaving a tombstone, by
+	 * moving back every later slot of the run that may live closer to home
+	 * @param slot
+	 */
+	void _unlink(size_t slot)
+	{
+		size_t mask = _index.size() - 1;
+		size_t hole = slot;
+		for(size_t next = (slot + 1) & mask; _index[next] != DENSE_EMPTY; next = (next + 1) & mask)
+		{
+			size_t home = _hashes[_index[next]] & mask;
+			if(((next - home) & mask) >= ((next - hole) & mask))
+			{
+				_index[hole] = _index[next];
+				hole = next;
+			}
+		}
+
+		_index[hole] = DENSE_EMPTY;
+	}
+
+	/**
+	 * Rebuild the position table with given capacity, the pairs stay put
+	 * @param newCap new capacity, rounded up to a power of two no smaller
+	 * than DEF_CAP and big enough for the current pairs
+	 */
+	void _rehash(int newCap)
+	{
+		size_t cap = DEF_CAP;
+		while(cap < (size_t) newCap || _entries.size() >= cap * _dUpper)
+		{
+			cap *= 2;
+		}
+
+		_index.assign(cap, DENSE_EMPTY);
+		for(size_t i = 0; i < _entries.size(); ++i)
+		{
+			_link(_hashes[i], (int32_t) i);
+		}
+	}
+
+	Hash _hasher;
+	KeyEqual _keyEqual;
+	double _dLower;
+	double _dUpper;
+	vector<value_type> _entries;
+	vector<size_t> _hashes;
+	vector<int32_t> _index;
+};
+
+#endif //CPP_EX3_DENSEHASHMAP_HPP
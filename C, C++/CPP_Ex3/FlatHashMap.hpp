@@ -0,0 +1,1035 @@
+#ifndef CPP_EX3_FLATHASHMAP_HPP
+#define CPP_EX3_FLATHASHMAP_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <utility>
+#include "HashMap.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define GROUP_WIDTH 16
+#define FLAT_MAX_LOAD 0.875
+#define CTRL_EMPTY ((int8_t) -128)
+#define CTRL_DELETED ((int8_t) -2)
+
+/**
+ * Open addressing HashMap in the spirit of SwissTable. Every slot has a control
+ * byte that is either empty, deleted, or holds the low 7 bits of the hash of the
+ * key stored in it. Control bytes are kept in their own array and are probed
+ * GROUP_WIDTH at a time (with SSE2 when available), so most lookups touch one
+ * line of control bytes and a single slot. The public API mirrors HashMap so the
+ * two can be swapped for each other.
+ * @tparam KeyT type of key
+ * @tparam ValueT type of value
+ */
+template <class KeyT, class ValueT>
+class FlatHashMap
+{
+	/**
+	 * Enables the lookup overloads taking a key of type K other than KeyT,
+	 * only available when the key hash is transparent
+	 */
+	template <class K>
+	using heterogeneousKey = typename std::enable_if<isTransparent<KeyHash<KeyT>>::value &&
+	                                                 !std::is_same<K, KeyT>::value, int>::type;
+
+public:
+	typedef pair<KeyT, ValueT> value_type;
+
+	/**
+	 * Constructor that receives upper and lower load factors. The upper bound
+	 * is capped at FLAT_MAX_LOAD since open addressing degrades past it
+	 * @param dLower lower bound
+	 * @param dUpper upper bound
+	 */
+	FlatHashMap(double dLower, double dUpper):
+			_dLower(dLower),
+			_dUpper(dUpper < FLAT_MAX_LOAD ? dUpper : FLAT_MAX_LOAD),
+			_iSize(DEF_SIZE),
+			_iDeleted(0),
+			_iCapacity(0),
+			_ctrl(_emptyGroup()),
+			_slots(nullptr)
+	{
+		_allocate(DEF_CAP);
+	}
+
+	/**
+	 * Default constructor, empty map with fUpper = 0.75 and fLower = 0.25
+	 */
+	FlatHashMap(): FlatHashMap(DEF_LOWER, DEF_UPPER) {}
+
+	/**
+	 * Constructor that receives a key vector and a value vector,
+	 * creates map of keys and values with corresponding indices
+	 * @param keyVec vector of keys
+	 * @param valVec vector of values
+	 */
+	FlatHashMap(const vector<KeyT> &keyVec, const vector<ValueT> &valVec): FlatHashMap()
+	{
+		if(keyVec.size() != valVec.size())
+		{
+			throw differentVectorSizes("Vectors are of different sizes");
+		}
+
+		for(unsigned long i = 0; i < keyVec.size(); ++i)
+		{
+			insert(keyVec[i], valVec[i]);
+		}
+	}
+
+	/**
+	 * Copy constructor
+	 * @param other
+	 */
+	FlatHashMap(const FlatHashMap &other):
+			_dLower(other._dLower),
+			_dUpper(other._dUpper),
+			_iSize(DEF_SIZE),
+			_iDeleted(0),
+			_iCapacity(0),
+			_ctrl(_emptyGroup()),
+			_slots(nullptr)
+	{
+		_allocate(other._iCapacity > 0 ? other._iCapacity : DEF_CAP);
+		for(int i = 0; i < other._iCapacity; ++i)
+		{
+			if(_isFull(other._ctrl[i]))
+			{
+				size_t hash = _hash(other._slots[i].first);
+				size_t idx = _findFreeSlot(hash);
+				new(_slots + idx) value_type(other._slots[i]);
+				_setCtrl(idx, _h2(hash));
+				_iSize++;
+			}
+		}
+	}
+
+	/**
+	 * Move constructor, steals the storage of other and leaves it empty
+	 * @param other
+	 */
+	FlatHashMap(FlatHashMap &&other) noexcept:
+			_dLower(other._dLower),
+			_dUpper(other._dUpper),
+			_iSize(other._iSize),
+			_iDeleted(other._iDeleted),
+			_iCapacity(other._iCapacity),
+			_ctrl(other._ctrl),
+			_slots(other._slots)
+	{
+		other._release();
+	}
+
+	/**
+	 * Destructor
+	 */
+	~FlatHashMap()
+	{
+		_destroy();
+	}
+
+	/**
+	 * Get amount of cells currently occupied
+	 * @return
+	 */
+	int size() const
+	{
+		return _iSize;
+	}
+
+	/**
+	 * Get the amount of elements the map is capable of storing
+	 * @return
+	 */
+	int capacity() const
+	{
+		return _iCapacity;
+	}
+
+	/**
+	 * Get current load factor (size / capacity)
+	 * @return
+	 */
+	double getLoadFactor() const
+	{
+		return _iCapacity == 0 ? 0 : (double) _iSize / _iCapacity;
+	}
+
+	/**
+	 * Check if map is empty
+	 * @return true if empty, otherwise false
+	 */
+	bool empty() const
+	{
+		return _iSize == 0;
+	}
+
+	/**
+	 * Check if map contains given key
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool containsKey(const KeyT &key) const
+	{
+		return _find(key, _hash(key)) >= 0;
+	}
+
+	/**
+	 * Check if map contains a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool containsKey(const K &key) const
+	{
+		return _find(key, _hash(key)) >= 0;
+	}
+
+	/**
+	 * Look up the value bound to key with a single hash and probe sequence
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present. The pointer
+	 * is invalidated by any later insertion or erasure
+	 */
+	ValueT* find(const KeyT &key)
+	{
+		long idx = _find(key, _hash(key));
+		return idx < 0 ? nullptr : &_slots[idx].second;
+	}
+
+	/**
+	 * Look up the value bound to key with a single hash and probe sequence
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	const ValueT* find(const KeyT &key) const
+	{
+		long idx = _find(key, _hash(key));
+		return idx < 0 ? nullptr : &_slots[idx].second;
+	}
+
+	/**
+	 * Look up the value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	ValueT* find(const K &key)
+	{
+		long idx = _find(key, _hash(key));
+		return idx < 0 ? nullptr : &_slots[idx].second;
+	}
+
+	/**
+	 * Look up the value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	const ValueT* find(const K &key) const
+	{
+		long idx = _find(key, _hash(key));
+		return idx < 0 ? nullptr : &_slots[idx].second;
+	}
+
+	/**
+	 * Rebuild the table with capacity multiplied by factor. Also drops all
+	 * tombstones left behind by erase()
+	 * @param factor factor by which to resize
+	 */
+	void resize(double factor)
+	{
+		int newCap = (int) (_iCapacity * factor);
+		_rehash(newCap < GROUP_WIDTH ? GROUP_WIDTH : newCap);
+	}
+
+	/**
+	 * Insert given item to map
+	 * @param key key of item
+	 * @param value value of item
+	 * @return true if successfully inserted, otherwise false
+	 */
+	bool insert(KeyT key, ValueT value)
+	{
+		return try_emplace(std::move(key), std::move(value)).second;
+	}
+
+	/**
+	 * Insert given pair to map, moving it into its slot
+	 * @param item item to be inserted
+	 * @return true if successfully inserted, otherwise false
+	 */
+	bool insert(value_type &&item)
+	{
+		size_t hash = _hash(item.first);
+		if(_find(item.first, hash) >= 0)
+		{
+			return false;
+		}
+
+		_emplaceNew(hash, std::move(item));
+		return true;
+	}
+
+	/**
+	 * Construct a pair from args and insert it if its key is not present.
+	 * Prefer try_emplace() when the key is at hand, since it does not build
+	 * the value for keys that are already present
+	 * @param args arguments forwarded to the constructor of value_type
+	 * @return pointer to the value bound to the key and true if it was
+	 * inserted, false if the key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> emplace(Args&&... args)
+	{
+		value_type item(std::forward<Args>(args)...);
+		size_t hash = _hash(item.first);
+		long idx = _find(item.first, hash);
+		if(idx >= 0)
+		{
+			return pair<ValueT*, bool>(&_slots[idx].second, false);
+		}
+
+		idx = (long) _emplaceNew(hash, std::move(item));
+		return pair<ValueT*, bool>(&_slots[idx].second, true);
+	}
+
+	/**
+	 * Insert a value constructed from args if key is not present, otherwise
+	 * leave the map untouched. Hashes key and probes once
+	 * @param key key to look up
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and true if it was inserted,
+	 * false if key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> try_emplace(const KeyT &key, Args&&... args)
+	{
+		return _tryEmplace(key, std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Same as try_emplace(const KeyT&, Args&&...), but moves key into the map
+	 * if it is inserted
+	 * @param key key to look up
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and true if it was inserted,
+	 * false if key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> try_emplace(KeyT &&key, Args&&... args)
+	{
+		return _tryEmplace(std::move(key), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Bind value to key, overwriting the current value if key is present
+	 * @param key key to assign
+	 * @param value value to bind
+	 * @return true if key was inserted, false if an existing value was assigned
+	 */
+	bool insert_or_assign(const KeyT &key, const ValueT &value)
+	{
+		pair<ValueT*, bool> result = try_emplace(key, value);
+		if(!result.second)
+		{
+			*result.first = value;
+		}
+
+		return result.second;
+	}
+
+	/**
+	 * Get value at key in map. Throws exception if key not present
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
+	 */
+	ValueT at(const KeyT &key) const
+	{
+		return _slots[_findOrThrow(key)].second;
+	}
+
+	/**
+	 * Get value at a key equal to key, without converting it to KeyT. Throws
+	 * exception if key not present
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return value bound to key, or exception if key not found
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	ValueT at(const K &key) const
+	{
+		return _slots[_findOrThrow(key)].second;
+	}
+
+	/**
+	 * Erase value bound to key
+	 * @param key key to look up
+	 * @return true if value successfully erased, otherwise false
+	 */
+	bool erase(const KeyT &key)
+	{
+		return _eraseAt(_find(key, _hash(key)));
+	}
+
+	/**
+	 * Erase value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if value successfully erased, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool erase(const K &key)
+	{
+		return _eraseAt(_find(key, _hash(key)));
+	}
+
+	/**
+	 * Get the amount of occupied slots in the probe group the key hashes to,
+	 * the open addressing counterpart of HashMap::bucketSize()
+	 * @param key key to look up
+	 * @return
+	 */
+	int bucketSize(const KeyT &key) const
+	{
+		if(_iCapacity == 0)
+		{
+			return 0;
+		}
+
+		size_t pos = (_hash(key) >> 7) & (_iCapacity - 1);
+		int count = 0;
+		for(int i = 0; i < GROUP_WIDTH; ++i)
+		{
+			count += _isFull(_ctrl[pos + i]) ? 1 : 0;
+		}
+
+		return count;
+	}
+
+	/**
+	 * Erase all pairs from map, keeps the current capacity
+	 */
+	void clear()
+	{
+		for(int i = 0; i < _iCapacity; ++i)
+		{
+			if(_isFull(_ctrl[i]))
+			{
+				_slots[i].~value_type();
+			}
+		}
+
+		if(_iCapacity > 0)
+		{
+			std::memset(_ctrl, CTRL_EMPTY, _iCapacity + GROUP_WIDTH);
+		}
+
+		_iSize = DEF_SIZE;
+		_iDeleted = 0;
+	}
+
+	/**
+	 * Overload for = operator, deep copies other
+	 * @param other map to copy
+	 * @return reference to map
+	 */
+	FlatHashMap& operator=(const FlatHashMap &other)
+	{
+		if(this != &other)
+		{
+			FlatHashMap copy(other);
+			_swap(copy);
+		}
+
+		return *this;
+	}
+
+	/**
+	 * Overload for move = operator, steals the storage of other
+	 * @param other map to move from
+	 * @return reference to map
+	 */
+	FlatHashMap& operator=(FlatHashMap &&other) noexcept
+	{
+		if(this != &other)
+		{
+			_destroy();
+			_dLower = other._dLower;
+			_dUpper = other._dUpper;
+			_iSize = other._iSize;
+			_iDeleted = other._iDeleted;
+			_iCapacity = other._iCapacity;
+			_ctrl = other._ctrl;
+			_slots = other._slots;
+			other._release();
+		}
+
+		return *this;
+	}
+
+	/**
+	 * Overload for [] operator, returns value corresponding to given key.
+	 * Throws exception if key not present
+	 * @param key key to look up
+	 * @return value attached to key
+	 */
+	const ValueT& operator[](const KeyT &key) const
+	{
+		return _slots[_findOrThrow(key)].second;
+	}
+
+	/**
+	 * Overload for [] operator, creates new pair if key not present
+	 * @param key key to assign
+	 * @return reference to value
+	 */
+	ValueT& operator[](const KeyT &key)
+	{
+		return *try_emplace(key).first;
+	}
+
+	/**
+	 * Overload for == operator, checks that all fields are equal
+	 * @param other map to compare to
+	 * @return true if all fields are equal, otherwise false
+	 */
+	bool operator==(const FlatHashMap &other) const
+	{
+		if(_iSize != other._iSize ||
+		   _iCapacity != other._iCapacity ||
+		   _dUpper != other._dUpper ||
+		   _dLower != other._dLower)
+		{
+			return false;
+		}
+
+		for(const auto &item: other)
+		{
+			long idx = _find(item.first, _hash(item.first));
+			if(idx < 0 || !(_slots[idx].second == item.second))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Overload for != operator
+	 * @param other map to compare to
+	 * @return opposite of ==
+	 */
+	bool operator!=(const FlatHashMap &other) const
+	{
+		return !(operator==(other));
+	}
+
+	/**
+	 * Nested Iterator class, walks the control bytes and stops on full slots
+	 */
+	class const_iterator
+	{
+	public:
+		/**
+		 * Constructor that accepts the control bytes and slots of the map
+		 * @param ctrl control bytes of the map
+		 * @param slots slot array of the map
+		 * @param idx slot to start from
+		 * @param mapCap capacity of the map
+		 */
+		const_iterator(const int8_t *ctrl, const value_type *slots, int idx, int mapCap):
+				_ctrl(ctrl),
+				_slots(slots),
+				_idx(idx),
+				_mapCap(mapCap)
+		{
+			_skipEmpty();
+		}
+
+		/**
+		 * Prefix increment operator, moves to the next full slot
+		 * @return next element in iteration
+		 */
+		const_iterator& operator++()
+		{
+			++_idx;
+			_skipEmpty();
+			return *this;
+		}
+
+		/**
+		 * Postfix increment operator
+		 * @return element before the increment
+		 */
+		const const_iterator operator++(int)
+		{
+			const_iterator temp = *this;
+			operator++();
+			return temp;
+		}
+
+		/**
+		 * Overload for dereference * operator
+		 * @return the item in the map to which the iterator points
+		 */
+		const value_type& operator*() const
+		{
+			return _slots[_idx];
+		}
+
+		/**
+		 * Overload for -> operator
+		 * @return
+		 */
+		const value_type* operator->() const
+		{
+			return _slots + _idx;
+		}
+
+		/**
+		 * Overload for == operator
+		 * @param other iterator to compare to
+		 * @return true if iterators point to the same slot, otherwise false
+		 */
+		bool operator==(const const_iterator &other) const
+		{
+			return _idx == other._idx;
+		}
+
+		/**
+		 * Overload for != operator
+		 * @param other iterator to compare to
+		 * @return opposite of ==
+		 */
+		bool operator!=(const const_iterator &other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		/**
+		 * Advance to the first full slot at or after the current one
+		 */
+		void _skipEmpty()
+		{
+			while(_idx < _mapCap && _ctrl[_idx] < 0)
+			{
+				++_idx;
+			}
+		}
+
+		const int8_t *_ctrl;
+		const value_type *_slots;
+		int _idx;
+		int _mapCap;
+	};
+
+	/**
+	 * Returns first element in iteration
+	 * @return
+	 */
+	const_iterator begin() const
+	{
+		return const_iterator(_ctrl, _slots, 0, _iCapacity);
+	}
+
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator end() const
+	{
+		return const_iterator(_ctrl, _slots, _iCapacity, _iCapacity);
+	}
+
+	/**
+	 * Returns first element in iteration
+	 * @return
+	 */
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator cend() const
+	{
+		return end();
+	}
+
+private:
+	/**
+	 * Control bytes used by maps without storage (moved from), all empty so
+	 * that a probe on them ends at the first group
+	 * @return
+	 */
+	static int8_t* _emptyGroup()
+	{
+		alignas(GROUP_WIDTH) static int8_t group[GROUP_WIDTH] = {
+				CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY,
+				CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY,
+				CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY,
+				CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY, CTRL_EMPTY};
+		return group;
+	}
+
+	/**
+	 * Check if control byte marks a slot holding an element
+	 * @param ctrl control byte
+	 * @return
+	 */
+	static bool _isFull(int8_t ctrl)
+	{
+		return ctrl >= 0;
+	}
+
+	/**
+	 * Hash a key, or anything the key hash accepts. std::hash is the identity
+	 * for integers, so the result is mixed to spread entropy over the bits
+	 * used for h1 and h2
+	 * @param key key to hash
+	 * @return
+	 */
+	template <class K>
+	static size_t _hash(const K &key)
+	{
+		KeyHash<KeyT> keyHasher;
+		uint64_t hash = keyHasher(key);
+		hash ^= hash >> 32;
+		hash *= 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 29;
+		return (size_t) hash;
+	}
+
+	/**
+	 * Part of the hash stored in the control byte
+	 * @param hash
+	 * @return
+	 */
+	static int8_t _h2(size_t hash)
+	{
+		return (int8_t) (hash & 0x7F);
+	}
+
+	/**
+	 * Bitmask of the slots in the group starting at pos whose control byte
+	 * equals value
+	 * @param pos first slot of the group
+	 * @param value control byte to look for
+	 * @return
+	 */
+	uint32_t _matchGroup(size_t pos, int8_t value) const
+	{
+#ifdef __SSE2__
+		__m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_ctrl + pos));
+		return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+		uint32_t mask = 0;
+		for(int i = 0; i < GROUP_WIDTH; ++i)
+		{
+			mask |= (uint32_t) (_ctrl[pos + i] == value) << i;
+		}
+		return mask;
+#endif
+	}
+
+	/**
+	 * Bitmask of the slots in the group starting at pos that are empty or deleted
+	 * @param pos first slot of the group
+	 * @return
+	 */
+	uint32_t _matchFree(size_t pos) const
+	{
+#ifdef __SSE2__
+		__m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_ctrl + pos));
+		return (uint32_t) _mm_movemask_epi8(group);
+#else
+		uint32_t mask = 0;
+		for(int i = 0; i < GROUP_WIDTH; ++i)
+		{
+			mask |= (uint32_t) (_ctrl[pos + i] < 0) << i;
+		}
+		return mask;
+#endif
+	}
+
+	/**
+	 * Index of the lowest set bit of a non zero mask
+	 * @param mask
+	 * @return
+	 */
+	static int _lowestBit(uint32_t mask)
+	{
+		return __builtin_ctz(mask);
+	}
+
+	/**
+	 * Look up key along its probe sequence
+	 * @param key key to look up
+	 * @param hash hash of key
+	 * @return index of the slot holding key, or -1 if not present
+	 */
+	template <class K>
+	long _find(const K &key, size_t hash) const
+	{
+		size_t mask = _iCapacity == 0 ? 0 : (size_t) _iCapacity - 1;
+		size_t pos = (hash >> 7) & mask;
+		int8_t h2 = _h2(hash);
+
+		for(size_t step = GROUP_WIDTH;; step += GROUP_WIDTH)
+		{
+			for(uint32_t match = _matchGroup(pos, h2); match != 0; match &= match - 1)
+			{
+				size_t idx = (pos + _lowestBit(match)) & mask;
+				if(_slots[idx].first == key)
+				{
+					return (long) idx;
+				}
+			}
+
+			/* An empty slot in the group means key would have been placed here */
+			if(_matchGroup(pos, CTRL_EMPTY) != 0 || step > mask)
+			{
+				return -1;
+			}
+
+			pos = (pos + step) & mask;
+		}
+	}
+
+	/**
+	 * Look up key, throwing if it is not present
+	 * @param key key to look up
+	 * @return index of the slot holding key
+	 */
+	template <class K>
+	long _findOrThrow(const K &key) const
+	{
+		long idx = _find(key, _hash(key));
+		if(idx < 0)
+		{
+			throw invalidKeyException("Key not present in map");
+		}
+
+		return idx;
+	}
+
+	/**
+	 * Destroy the element in a slot and mark it deleted, shrinking the table
+	 * if the load drops below the lower bound
+	 * @param idx slot index as returned by _find()
+	 * @return false if idx is -1 (key not found), otherwise true
+	 */
+	bool _eraseAt(long idx)
+	{
+		if(idx < 0)
+		{
+			return false;
+		}
+
+		_slots[idx].~value_type();
+		_setCtrl(idx, CTRL_DELETED);
+		_iSize--;
+		_iDeleted++;
+
+		if(getLoadFactor() < _dLower && _iCapacity > DEF_CAP)
+		{
+			resize(LOWER_FACTOR);
+		}
+
+		return true;
+	}
+
+	/**
+	 * Find the first empty or deleted slot along the probe sequence of hash.
+	 * Table must have at least one such slot
+	 * @param hash
+	 * @return index of the slot
+	 */
+	size_t _findFreeSlot(size_t hash) const
+	{
+		size_t mask = (size_t) _iCapacity - 1;
+		size_t pos = (hash >> 7) & mask;
+
+		for(size_t step = GROUP_WIDTH;; step += GROUP_WIDTH)
+		{
+			uint32_t match = _matchFree(pos);
+			if(match != 0)
+			{
+				return (pos + _lowestBit(match)) & mask;
+			}
+
+			pos = (pos + step) & mask;
+		}
+	}
+
+	/**
+	 * Set a control byte, keeping the clone of the first group that follows
+	 * the table in sync so group loads never have to wrap around
+	 * @param idx slot index
+	 * @param value new control byte
+	 */
+	void _setCtrl(size_t idx, int8_t value)
+	{
+		_ctrl[idx] = value;
+		if(idx < GROUP_WIDTH)
+		{
+			_ctrl[_iCapacity + idx] = value;
+		}
+	}
+
+	/**
+	 * Place a key that is known to be absent, growing the table first if needed
+	 * @param hash hash of key
+	 * @param args arguments forwarded to the constructor of value_type
+	 * @return index of the new slot
+	 */
+	template <class... Args>
+	size_t _emplaceNew(size_t hash, Args&&... args)
+	{
+		if(_iCapacity == 0)
+		{
+			_allocate(DEF_CAP);
+		}
+		else if(_iSize + _iDeleted + 1 > _iCapacity * _dUpper)
+		{
+			/* Mostly tombstones: rebuild at the same size instead of growing */
+			_rehash(_iDeleted > _iSize ? _iCapacity : (int) (_iCapacity * UPPER_FACTOR));
+		}
+
+		size_t idx = _findFreeSlot(hash);
+		new(_slots + idx) value_type(std::forward<Args>(args)...);
+		if(_ctrl[idx] == CTRL_DELETED)
+		{
+			_iDeleted--;
+		}
+		_setCtrl(idx, _h2(hash));
+		_iSize++;
+		return idx;
+	}
+
+	/**
+	 * Shared implementation of try_emplace()
+	 * @param key key to look up, forwarded into the map if inserted
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and whether it was inserted
+	 */
+	template <class K, class... Args>
+	pair<ValueT*, bool> _tryEmplace(K &&key, Args&&... args)
+	{
+		size_t hash = _hash(key);
+		long idx = _find(key, hash);
+		if(idx >= 0)
+		{
+			return pair<ValueT*, bool>(&_slots[idx].second, false);
+		}
+
+		idx = (long) _emplaceNew(hash, std::piecewise_construct,
+		                         std::forward_as_tuple(std::forward<K>(key)),
+		                         std::forward_as_tuple(std::forward<Args>(args)...));
+		return pair<ValueT*, bool>(&_slots[idx].second, true);
+	}
+
+	/**
+	 * Move every element into freshly allocated storage of given capacity
+	 * @param newCap new capacity, a power of two no smaller than GROUP_WIDTH
+	 */
+	void _rehash(int newCap)
+	{
+		int8_t *oldCtrl = _ctrl;
+		value_type *oldSlots = _slots;
+		int oldCap = _iCapacity;
+
+		_allocate(newCap);
+		for(int i = 0; i < oldCap; ++i)
+		{
+			if(_isFull(oldCtrl[i]))
+			{
+				size_t hash = _hash(oldSlots[i].first);
+				size_t idx = _findFreeSlot(hash);
+				new(_slots + idx) value_type(std::move(oldSlots[i]));
+				_setCtrl(idx, _h2(hash));
+				oldSlots[i].~value_type();
+			}
+		}
+
+		if(oldCap > 0)
+		{
+			delete[] oldCtrl;
+			::operator delete(oldSlots);
+		}
+	}
+
+	/**
+	 * Point the map at new, empty storage of given capacity. Does not free
+	 * the previous storage
+	 * @param cap capacity, a power of two no smaller than GROUP_WIDTH
+	 */
+	void _allocate(int cap)
+	{
+		_ctrl = new int8_t[cap + GROUP_WIDTH];
+		std::memset(_ctrl, CTRL_EMPTY, cap + GROUP_WIDTH);
+		_slots = static_cast<value_type*>(::operator new(sizeof(value_type) * cap));
+		_iCapacity = cap;
+		_iDeleted = 0;
+	}
+
+	/**
+	 * Destroy all elements and free the storage
+	 */
+	void _destroy()
+	{
+		if(_iCapacity > 0)
+		{
+			clear();
+			delete[] _ctrl;
+			::operator delete(_slots);
+		}
+	}
+
+	/**
+	 * Leave the map empty and without storage, used after moving from it
+	 */
+	void _release()
+	{
+		_iSize = DEF_SIZE;
+		_iDeleted = 0;
+		_iCapacity = 0;
+		_ctrl = _emptyGroup();
+		_slots = nullptr;
+	}
+
+	/**
+	 * Exchange contents with other
+	 * @param other
+	 */
+	void _swap(FlatHashMap &other)
+	{
+		std::swap(_dLower, other._dLower);
+		std::swap(_dUpper, other._dUpper);
+		std::swap(_iSize, other._iSize);
+		std::swap(_iDeleted, other._iDeleted);
+		std::swap(_iCapacity, other._iCapacity);
+		std::swap(_ctrl, other._ctrl);
+		std::swap(_slots, other._slots);
+	}
+
+	double _dLower;
+	double _dUpper;
+	int _iSize;
+	int _iDeleted;
+	int _iCapacity;
+	int8_t *_ctrl;
+	value_type *_slots;
+};
+
+#endif //CPP_EX3_FLATHASHMAP_HPP
@@ -0,0 +1,393 @@
+#ifndef CPP_EX3_FROZENHASHMAP_HPP
+#define CPP_EX3_FROZENHASHMAP_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "HashMap.hpp"
+
+#define FROZEN_MAGIC "HMFROZEN"
+#define FROZEN_VERSION 2
+#define FROZEN_ENDIAN_TAG 0x01020304
+#define FROZEN_EMPTY_SLOT 0xFFFFFFFF
+#define FROZEN_HASH_SEED 0x9E3779B97F4A7C15ULL
+
+/**
+ * Exception to be thrown when bytes given to FrozenHashMap are not a valid image
+ */
+class invalidImageException: public std::exception
+{
+public:
+	/**
+	 * Constructor that prints a message
+	 * @param message
+	 */
+	explicit invalidImageException(char const* msg): _msg(msg) {}
+
+	const char* what() const noexcept override
+	{
+		return _msg.c_str();
+	}
+
+private:
+	std::string _msg;
+};
+
+/**
+ * Immutable string to int map stored as a single position independent binary
+ * image, meant to be written to disk once and mmap()ed by every later run.
+ * Lookups probe the image in place, so opening an image is O(1) in its size
+ * and nothing is parsed or allocated.
+ *
+ * Layout, all offsets are from the start of the image and all integers are
+ * in host byte order (checked through the endian tag):
+ *   Header
+ *   Slot[capacity]     open addressing table, linear probing, load <= 0.5
+ *   char[]             key bytes, referenced by the slots
+ */
+class FrozenHashMap
+{
+	/**
+	 * Image header
+	 */
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t endianTag;
+		uint64_t size;
+		uint64_t capacity;
+		uint64_t slotsOffset;
+		uint64_t keysOffset;
+		uint64_t keysBytes;
+	};
+
+	/**
+	 * Table slot, keyOffset is FROZEN_EMPTY_SLOT for empty slots
+	 */
+	struct Slot
+	{
+		uint64_t hash;
+		uint32_t keyOffset;
+		uint32_t keyLength;
+		int32_t value;
+		uint32_t padding;
+	};
+
+public:
+	/**
+	 * Constructor that views an image already in memory, which must outlive
+	 * this map. Throws invalidImageException if the bytes are not an image
+	 * @param data start of the image, aligned to 8 bytes
+	 * @param bytes size of the image
+	 */
+	FrozenHashMap(const void *data, size_t bytes):
+			_base(static_cast<const char*>(data)),
+			_bytes(bytes),
+			_bMapped(false)
+	{
+		_validate();
+	}
+
+	/**
+	 * Constructor that maps an image file read only. Throws
+	 * invalidImageException if the file can't be mapped or is not an image
+	 * @param fileName path of the image
+	 */
+	explicit FrozenHashMap(const std::string &fileName):
+			_base(nullptr),
+			_bytes(0),
+			_bMapped(true)
+	{
+		int fd = open(fileName.c_str(), O_RDONLY);
+		if(fd < 0)
+		{
+			throw invalidImageException("Can't open image file");
+		}
+
+		struct stat info;
+		if(fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			close(fd);
+			throw invalidImageException("Can't read image file");
+		}
+
+		void *addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(addr == MAP_FAILED)
+		{
+			throw invalidImageException("Can't map image file");
+		}
+
+		_base = static_cast<const char*>(addr);
+		_bytes = info.st_size;
+
+		try
+		{
+			_validate();
+		}
+		catch(const invalidImageException &)
+		{
+			munmap(const_cast<char*>(_base), _bytes);
+			throw;
+		}
+	}
+
+	FrozenHashMap(const FrozenHashMap &other) = delete;
+
+	FrozenHashMap& operator=(const FrozenHashMap &other) = delete;
+
+	/**
+	 * Move constructor, takes over the mapping of other
+	 * @param other
+	 */
+	FrozenHashMap(FrozenHashMap &&other) noexcept:
+			_base(other._base),
+			_bytes(other._bytes),
+			_bMapped(other._bMapped),
+			_header(other._header),
+			_slots(other._slots),
+			_keys(other._keys)
+	{
+		other._bMapped = false;
+	}
+
+	/**
+	 * Destructor, unmaps the image if this map mapped it
+	 */
+	~FrozenHashMap()
+	{
+		if(_bMapped)
+		{
+			munmap(const_cast<char*>(_base), _bytes);
+		}
+	}
+
+	/**
+	 * Build the image of a map of strings to ints
+	 * @param map any map whose iteration yields pairs of string and int
+	 * @return the bytes of the image
+	 */
+	template <class Map>
+	static std::string freeze(const Map &map)
+	{
+		uint64_t capacity = DEF_CAP;
+		while(capacity < 2 * (uint64_t) map.size())
+		{
+			capacity *= 2;
+		}
+
+		uint64_t keysBytes = 0;
+		for(auto it = map.begin(); it != map.end(); ++it)
+		{
+			keysBytes += it -> first.size();
+		}
+
+		Header header;
+		std::memcpy(header.magic, FROZEN_MAGIC, sizeof(header.magic));
+		header.version = FROZEN_VERSION;
+		header.endianTag = FROZEN_ENDIAN_TAG;
+		header.size = map.size();
+		header.capacity = capacity;
+		header.slotsOffset = sizeof(Header);
+		header.keysOffset = sizeof(Header) + capacity * sizeof(Slot);
+		header.keysBytes = keysBytes;
+
+		if(keysBytes >= FROZEN_EMPTY_SLOT)
+		{
+			throw invalidImageException("Keys too large for a frozen image");
+		}
+
+		std::string image(header.keysOffset + keysBytes, '\0');
+		std::memcpy(&image[0], &header, sizeof(Header));
+
+		Slot *slots = reinterpret_cast<Slot*>(&image[header.slotsOffset]);
+		for(uint64_t i = 0; i < capacity; ++i)
+		{
+			slots[i].keyOffset = FROZEN_EMPTY_SLOT;
+		}
+
+		uint32_t keyOffset = 0;
+		for(auto it = map.begin(); it != map.end(); ++it)
+		{
+			const std::string &key = it -> first;
+			uint64_t hash = frozenHash(key);
+			uint64_t idx = hash & (capacity - 1);
+			while(slots[idx].keyOffset != FROZEN_EMPTY_SLOT)
+			{
+				idx = (idx + 1) & (capacity - 1);
+			}
+
+			slots[idx].hash = hash;
+			slots[idx].keyOffset = keyOffset;
+			slots[idx].keyLength = (uint32_t) key.size();
+			slots[idx].value = it -> second;
+			std::memcpy(&image[header.keysOffset + keyOffset], key.data(), key.size());
+			keyOffset += (uint32_t) key.size();
+		}
+
+		return image;
+	}
+
+	/**
+	 * Write the image of a map to a file
+	 * @param map any map whose iteration yields pairs of string and int
+	 * @param fileName path to write to
+	 * @return true if written, otherwise false
+	 */
+	template <class Map>
+	static bool writeFile(const Map &map, const std::string &fileName)
+	{
+		std::string image = freeze(map);
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		file.write(image.data(), image.size());
+		return (bool) file;
+	}
+
+	/**
+	 * Hash used inside images, hashBytes() with a seed of its own. Unlike
+	 * std::hash it is fixed across builds, which an image written by one
+	 * process and read by another needs. Images of version 1 used FNV-1a
+	 * @param key
+	 * @return
+	 */
+	static uint64_t frozenHash(std::string_view key)
+	{
+		return hashBytes(key.data(), key.size(), FROZEN_HASH_SEED);
+	}
+
+	/**
+	 * Get amount of pairs in the map
+	 * @return
+	 */
+	int size() const
+	{
+		return (int) _header -> size;
+	}
+
+	/**
+	 * Get amount of slots in the image
+	 * @return
+	 */
+	int capacity() const
+	{
+		return (int) _header -> capacity;
+	}
+
+	/**
+	 * Check if map is empty
+	 * @return true if empty, otherwise false
+	 */
+	bool empty() const
+	{
+		return _header -> size == 0;
+	}
+
+	/**
+	 * Check if map contains given key
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool containsKey(std::string_view key) const
+	{
+		return find(key) != nullptr;
+	}
+
+	/**
+	 * Look up the value bound to key inside the image
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	const int* find(std::string_view key) const
+	{
+		uint64_t hash = frozenHash(key);
+		uint64_t mask = _header -> capacity - 1;
+
+		/* The header alone doesn't promise an empty slot, so a probe never
+		 * goes around the table more than once */
+		uint64_t idx = hash & mask;
+		for(uint64_t probe = 0; probe <= mask; ++probe, idx = (idx + 1) & mask)
+		{
+			const Slot &slot = _slots[idx];
+			if(slot.keyOffset == FROZEN_EMPTY_SLOT)
+			{
+				return nullptr;
+			}
+
+			if(slot.hash == hash && slot.keyLength == key.size() &&
+			   (uint64_t) slot.keyOffset + slot.keyLength <= _header -> keysBytes &&
+			   std::memcmp(_keys + slot.keyOffset, key.data(), key.size()) == 0)
+			{
+				return &slot.value;
+			}
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * Get value at key in map. Throws exception if key not present
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
+	 */
+	int at(std::string_view key) const
+	{
+		const int *value = find(key);
+		if(value == nullptr)
+		{
+			throw invalidKeyException("Key not present in map");
+		}
+
+		return *value;
+	}
+
+private:
+	/**
+	 * Check the header against the size of the image and set up the pointers
+	 * into it. Only the header is read, so this is O(1). Sizes are compared
+	 * before they are multiplied, so a crafted capacity can't wrap around
+	 */
+	void _validate()
+	{
+		if(_bytes < sizeof(Header) || ((uintptr_t) _base % alignof(Header)) != 0)
+		{
+			throw invalidImageException("Image too small or misaligned");
+		}
+
+		_header = reinterpret_cast<const Header*>(_base);
+		if(std::memcmp(_header -> magic, FROZEN_MAGIC, sizeof(_header -> magic)) != 0 ||
+		   _header -> version != FROZEN_VERSION ||
+		   _header -> endianTag != FROZEN_ENDIAN_TAG)
+		{
+			throw invalidImageException("Not a frozen map image");
+		}
+
+		uint64_t capacity = _header -> capacity;
+		if(capacity == 0 || (capacity & (capacity - 1)) != 0 || _header -> size >= capacity ||
+		   capacity > (_bytes - sizeof(Header)) / sizeof(Slot) ||
+		   _header -> slotsOffset != sizeof(Header) ||
+		   _header -> keysOffset != sizeof(Header) + capacity * sizeof(Slot) ||
+		   _header -> keysBytes != _bytes - _header -> keysOffset)
+		{
+			throw invalidImageException("Corrupt frozen map image");
+		}
+
+		_slots = reinterpret_cast<const Slot*>(_base + _header -> slotsOffset);
+		_keys = _base + _header -> keysOffset;
+	}
+
+	const char *_base;
+	size_t _bytes;
+	bool _bMapped;
+	const Header *_header;
+	const Slot *_slots;
+	const char *_keys;
+};
+
+#endif //CPP_EX3_FROZENHASHMAP_HPP
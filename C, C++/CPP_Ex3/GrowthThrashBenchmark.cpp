@@ -0,0 +1,71 @@
+#include <iostream>
+#include <chrono>
+#include "HashMap.hpp"
+
+#define THRASH_CAPACITY (1 << 17)
+#define THRASH_OPS 200
+#define THRASH_LOWER 0.5
+#define THRASH_UPPER 0.75
+#define NO_HYSTERESIS 1.0
+
+/**
+ * Time insert/erase of one key at the grow boundary of a map with given policy
+ * @param policy growth policy of the map
+ * @param rehashes set to amount of operations that changed the capacity
+ * @return seconds taken by THRASH_OPS operations
+ */
+double thrash(const GrowthPolicy &policy, int &rehashes)
+{
+	HashMap<int, int> map(policy);
+
+	/* Fill the map to dUpper of THRASH_CAPACITY, the next insertion grows it */
+	int fill = (int) (THRASH_CAPACITY * policy.dUpper);
+	for(int key = 0; key < fill; ++key)
+	{
+		map.insert(key, key);
+	}
+
+	rehashes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for(int op = 0; op < THRASH_OPS; ++op)
+	{
+		int capacity = map.capacity();
+		if(op % 2 == 0)
+		{
+			map.insert(fill, fill);
+		}
+		else
+		{
+			map.erase(fill);
+		}
+
+		if(map.capacity() != capacity)
+		{
+			rehashes++;
+		}
+	}
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Reproduces the resize thrash of a HashMap with load factor bounds (0.5, 0.75):
+ * alternately inserting and erasing one key at the grow boundary rehashes the
+ * whole map on every operation when the shrink load is dLower as is, and never
+ * once dLower is capped at dUpper / SHRINK_HYSTERESIS
+ * @return
+ */
+int main()
+{
+	int rehashes = 0;
+
+	double seconds = thrash(GrowthPolicy(THRASH_LOWER, THRASH_UPPER, DEF_CAP, true, NO_HYSTERESIS), rehashes);
+	std::cout << "old policy (no hysteresis): " << THRASH_OPS << " ops, " << rehashes << " rehashes, "
+	          << seconds << "s\n";
+
+	seconds = thrash(GrowthPolicy(THRASH_LOWER, THRASH_UPPER), rehashes);
+	std::cout << "new policy (hysteresis " << SHRINK_HYSTERESIS << "): " << THRASH_OPS << " ops, " << rehashes
+	          << " rehashes, " << seconds << "s\n";
+
+	return EXIT_SUCCESS;
+}
@@ -2,8 +2,27 @@
 #define CPP_EX3_HASHMAP_HPP
 
 #include <iostream>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <cassert>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "MonotonicArena.hpp"
+#ifdef HASHMAP_STATS
+#include <atomic>
+#include <chrono>
+#endif
 using std::vector;
 using std::pair;
 
@@ -13,6 +32,12 @@ using std::pair;
 #define DEF_CAP 16
 #define UPPER_FACTOR 2.0
 #define LOWER_FACTOR 0.5
+#define REHASH_STEP 4
+#define BATCH_SIZE 16
+#define SHRINK_HYSTERESIS 3.0
+#define BLOOM_BITS_PER_BUCKET 16
+#define BLOOM_HASHES 6
+#define DEF_HASH_SEED 0x243F6A8885A308D3ULL
 
 /**
  * Exception to be thrown in case of invalid key for at() method
@@ -57,576 +82,2489 @@ private:
 	std::string _msg;
 };
 
+/**
+ * Mix the bits of an integer, the finalizer of MurmurHash3. Every input bit
+ * affects every output bit, so the low bits are usable as a bucket index
+ * @param key
+ * @return
+ */
+inline uint64_t mixInteger(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+/**
+ * Multiply two 64 bit words into 128 bits and fold the halves together
+ * @param a
+ * @param b
+ * @return
+ */
+inline uint64_t mixMultiply(uint64_t a, uint64_t b)
+{
+	unsigned __int128 product = (unsigned __int128) a * b;
+	return (uint64_t) product ^ (uint64_t) (product >> 64);
+}
+
+/**
+ * Read 8 bytes at any alignment, in host byte order
+ * @param bytes
+ * @return
+ */
+inline uint64_t read64(const char *bytes)
+{
+	uint64_t word;
+	std::memcpy(&word, bytes, sizeof(word));
+	return word;
+}
+
+/**
+ * Read 4 bytes at any alignment, in host byte order
+ * @param bytes
+ * @return
+ */
+inline uint64_t read32(const char *bytes)
+{
+	uint32_t word;
+	std::memcpy(&word, bytes, sizeof(word));
+	return word;
+}
+
+/**
+ * Hash a run of bytes, following wyhash: the bytes are consumed 16 at a
+ * time (48 at a time in three independent lanes for long keys) and every
+ * step is a single 64x64 -> 128 bit multiply, so a phrase of a few words
+ * costs a handful of multiplies instead of a multiply per byte. Keys of up
+ * to 16 bytes are read as at most four overlapping words, without a loop
+ * @param bytes start of the bytes
+ * @param length amount of bytes
+ * @param seed different seeds give unrelated hashes
+ * @return
+ */
+inline uint64_t hashBytes(const char *bytes, size_t length, uint64_t seed = DEF_HASH_SEED)
+{
+	static const uint64_t secret[4] = {0xA0761D6478BD642FULL, 0xE7037ED1A0B428DBULL,
+	                                   0x8EBC6AF09C88C6E3ULL, 0x589965CC75374CC3ULL};
+	seed ^= mixMultiply(seed ^ secret[0], secret[1]);
+
+	uint64_t a = 0;
+	uint64_t b = 0;
+	if(length <= 16)
+	{
+		if(length >= 4)
+		{
+			size_t middle = (length >> 3) << 2;
+			a = (read32(bytes) << 32) | read32(bytes + middle);
+			b = (read32(bytes + length - 4) << 32) | read32(bytes + length - 4 - middle);
+		}
+		else if(length > 0)
+		{
+			a = ((uint64_t) (unsigned char) bytes[0] << 16) | ((uint64_t) (unsigned char) bytes[length >> 1] << 8) |
+			    (unsigned char) bytes[length - 1];
+		}
+	}
+	else
+	{
+		const char *cur = bytes;
+		size_t left = length;
+		if(left > 48)
+		{
+			uint64_t lane1 = seed;
+			uint64_t lane2 = seed;
+			do
+			{
+				seed = mixMultiply(read64(cur) ^ secret[1], read64(cur + 8) ^ seed);
+				lane1 = mixMultiply(read64(cur + 16) ^ secret[2], read64(cur + 24) ^ lane1);
+				lane2 = mixMultiply(read64(cur + 32) ^ secret[3], read64(cur + 40) ^ lane2);
+				cur += 48;
+				left -= 48;
+			}
+			while(left > 48);
+
+			seed ^= lane1 ^ lane2;
+		}
+
+		while(left > 16)
+		{
+			seed = mixMultiply(read64(cur) ^ secret[1], read64(cur + 8) ^ seed);
+			cur += 16;
+			left -= 16;
+		}
+
+		a = read64(cur + left - 16);
+		b = read64(cur + left - 8);
+	}
+
+	unsigned __int128 product = (unsigned __int128) (a ^ secret[1]) * (b ^ seed);
+	return mixMultiply((uint64_t) product ^ secret[0] ^ length, (uint64_t) (product >> 64) ^ secret[1]);
+}
+
+/**
+ * Hash functor for HashMap keys, std::hash unless specialized. std::hash is
+ * the identity for integers, so keys sharing their low bits (multiples of a
+ * power of two, ids with tag bits) would share a bucket; integers are mixed
+ * instead
+ * @tparam KeyT type of key
+ */
+template <class KeyT>
+struct KeyHash
+{
+	size_t operator()(const KeyT &key) const
+	{
+		if constexpr(std::is_integral<KeyT>::value)
+		{
+			return (size_t) mixInteger((uint64_t) key);
+		}
+		else
+		{
+			std::hash<KeyT> keyHasher;
+			return keyHasher(key);
+		}
+	}
+};
+
+/**
+ * Transparent, seeded hash for string keys (see hashBytes()). Every string
+ * type is hashed through std::string_view, so a map of strings can be probed
+ * with a std::string_view or a const char* without building a temporary
+ * std::string. Maps that merge or compare hashes must share a seed
+ */
+template <>
+struct KeyHash<std::string>
+{
+	typedef void is_transparent;
+
+	/**
+	 * Constructor that receives the seed
+	 * @param seed
+	 */
+	explicit KeyHash(uint64_t seed = DEF_HASH_SEED): seed(seed) {}
+
+	size_t operator()(std::string_view key) const
+	{
+		return (size_t) hashBytes(key.data(), key.size(), seed);
+	}
+
+	uint64_t seed;
+};
+
+/**
+ * Check if a hash functor declares is_transparent, i.e. accepts types other
+ * than the key type
+ * @tparam H hash functor
+ */
+template <class H, class = void>
+struct isTransparent: std::false_type {};
+
+template <class H>
+struct isTransparent<H, std::void_t<typename H::is_transparent>>: std::true_type {};
+
+/**
+ * Check if an allocator declares is_monotonic, i.e. never reclaims memory
+ * before its arena is released, see MonotonicArena.hpp
+ * @tparam A allocator
+ */
+template <class A, class = void>
+struct isMonotonic: std::false_type {};
+
+template <class A>
+struct isMonotonic<A, std::void_t<typename A::is_monotonic>>: A::is_monotonic {};
+
+/**
+ * Entry stored in the buckets of HashMap, holds a pair and, when CacheHash is
+ * set, the full hash of its key
+ * @tparam KeyT type of key
+ * @tparam ValueT type of value
+ * @tparam CacheHash whether to store the hash next to the pair
+ */
+template <class KeyT, class ValueT, bool CacheHash>
+struct HashEntry
+{
+	/**
+	 * Constructor that builds the pair from args
+	 * @param hash hash of the key, unused
+	 * @param args arguments forwarded to the constructor of the pair
+	 */
+	template <class... Args>
+	explicit HashEntry(size_t, Args&&... args): item(std::forward<Args>(args)...) {}
+
+	/**
+	 * Quick rejection test before comparing keys, nothing to test without a cache
+	 * @return true
+	 */
+	bool hashMatches(size_t) const
+	{
+		return true;
+	}
+
+	/**
+	 * Get the hash of the key
+	 * @param hasher hash functor of the map
+	 * @return
+	 */
+	template <class Hash>
+	size_t hash(const Hash &hasher) const
+	{
+		return hasher(item.first);
+	}
+
+	pair<KeyT, ValueT> item;
+};
+
+/**
+ * Entry that caches the hash of its key, so resizes never rehash keys and
+ * lookups skip the key comparison for entries whose hash differs
+ */
+template <class KeyT, class ValueT>
+struct HashEntry<KeyT, ValueT, true>
+{
+	/**
+	 * Constructor that builds the pair from args
+	 * @param hash hash of the key
+	 * @param args arguments forwarded to the constructor of the pair
+	 */
+	template <class... Args>
+	explicit HashEntry(size_t hash, Args&&... args): item(std::forward<Args>(args)...), cachedHash(hash) {}
+
+	/**
+	 * Quick rejection test before comparing keys
+	 * @param hash hash of the key looked up
+	 * @return false if the key of this entry can't be equal, otherwise true
+	 */
+	bool hashMatches(size_t hash) const
+	{
+		return cachedHash == hash;
+	}
+
+	/**
+	 * Get the hash of the key
+	 * @return
+	 */
+	template <class Hash>
+	size_t hash(const Hash &) const
+	{
+		return cachedHash;
+	}
+
+	pair<KeyT, ValueT> item;
+	size_t cachedHash;
+};
+
+/**
+ * Decides when a HashMap grows and shrinks. The map grows by UPPER_FACTOR
+ * once the load reaches dUpper, and shrinks by LOWER_FACTOR once it drops
+ * below shrinkLoad(), never under iMinCapacity buckets. shrinkLoad() is
+ * dLower capped at dUpper / dHysteresis: with the default SHRINK_HYSTERESIS
+ * a grow halves the load to dUpper / 2, so the map has to lose a third of
+ * its pairs before it shrinks back, and a shrink leaves it well below dUpper.
+ * Without the cap (dHysteresis 1), bounds like (0.5, 0.75) make every
+ * insert/erase at the boundary rehash the map.
+ * With bShrinkOnErase off the map only shrinks in HashMap::shrink_to_fit()
+ */
+struct GrowthPolicy
+{
+	/**
+	 * Constructor that receives the load factor bounds and the capacity floor
+	 * @param dLower lower bound
+	 * @param dUpper upper bound
+	 * @param iMinCapacity least amount of buckets, rounded up to a power of two
+	 * @param bShrinkOnErase whether erase() may shrink the map
+	 * @param dHysteresis how far under dUpper the shrink load is capped, 1
+	 * for no cap
+	 */
+	GrowthPolicy(double dLower = DEF_LOWER, double dUpper = DEF_UPPER, int iMinCapacity = DEF_CAP,
+	             bool bShrinkOnErase = true, double dHysteresis = SHRINK_HYSTERESIS):
+			dLower(dLower),
+			dUpper(dUpper),
+			iMinCapacity(1),
+			bShrinkOnErase(bShrinkOnErase),
+			dHysteresis(dHysteresis)
+	{
+		while(this -> iMinCapacity < iMinCapacity)
+		{
+			this -> iMinCapacity *= 2;
+		}
+	}
+
+	/**
+	 * Get the load under which the map shrinks
+	 * @return
+	 */
+	double shrinkLoad() const
+	{
+		return dLower < dUpper / dHysteresis ? dLower : dUpper / dHysteresis;
+	}
+
+	/**
+	 * Check if a map of size pairs in capacity buckets has to grow before
+	 * its next insertion
+	 * @param size
+	 * @param capacity
+	 * @return
+	 */
+	bool shouldGrow(int size, int capacity) const
+	{
+		return (double) size / capacity >= dUpper;
+	}
+
+	/**
+	 * Check if a map of size pairs in capacity buckets should shrink after
+	 * an erasure
+	 * @param size
+	 * @param capacity
+	 * @return
+	 */
+	bool shouldShrink(int size, int capacity) const
+	{
+		return bShrinkOnErase && capacity > iMinCapacity && (double) size / capacity < shrinkLoad();
+	}
+
+	/**
+	 * Get the least capacity, a power of two no smaller than iMinCapacity,
+	 * that holds size pairs without reaching dUpper on the last insertion
+	 * @param size
+	 * @return
+	 */
+	int fitCapacity(int size) const
+	{
+		int capacity = iMinCapacity;
+		while(capacity * dUpper <= size - 1)
+		{
+			capacity *= 2;
+		}
+
+		return capacity;
+	}
+
+	double dLower;
+	double dUpper;
+	int iMinCapacity;
+	bool bShrinkOnErase;
+	double dHysteresis;
+};
+
+/**
+ * Blocked Bloom filter over hashes. Every hash sets BLOOM_HASHES bits inside
+ * a single 64 byte block, so a query reads one cache line whatever the size
+ * of the filter. Bits are never cleared one by one, a filter that should
+ * forget hashes is rebuilt
+ */
+class BloomFilter
+{
+	/**
+	 * 512 bits, one cache line
+	 */
+	struct alignas(64) Block
+	{
+		uint64_t words[8];
+	};
+
+public:
+	/**
+	 * Drop every hash and size the filter for a map of capacity buckets,
+	 * BLOOM_BITS_PER_BUCKET bits each
+	 * @param capacity amount of buckets, a power of two
+	 */
+	void reset(int capacity)
+	{
+		size_t blocks = 1;
+		while(blocks * sizeof(Block) * 8 < (size_t) capacity * BLOOM_BITS_PER_BUCKET)
+		{
+			blocks *= 2;
+		}
+
+		_blocks.assign(blocks, Block());
+	}
+
+	/**
+	 * Drop the filter, freeing its memory
+	 */
+	void release()
+	{
+		vector<Block>().swap(_blocks);
+	}
+
+	/**
+	 * Add a hash to the filter
+	 * @param hash
+	 */
+	void add(size_t hash)
+	{
+		if(_blocks.empty())
+		{
+			return;
+		}
+
+		uint64_t bits = mixInteger(hash);
+		Block &block = _blocks[_blockIndex(bits)];
+		for(int i = 0; i < BLOOM_HASHES; ++i, bits >>= 9)
+		{
+			block.words[(bits >> 6) & 7] |= 1ULL << (bits & 63);
+		}
+	}
+
+	/**
+	 * Check if a hash may have been added. An empty filter answers true
+	 * @param hash
+	 * @return false if hash was surely never added, otherwise true
+	 */
+	bool mayContain(size_t hash) const
+	{
+		if(_blocks.empty())
+		{
+			return true;
+		}
+
+		uint64_t bits = mixInteger(hash);
+		const Block &block = _blocks[_blockIndex(bits)];
+		for(int i = 0; i < BLOOM_HASHES; ++i, bits >>= 9)
+		{
+			if((block.words[(bits >> 6) & 7] & (1ULL << (bits & 63))) == 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Get the amount of bytes held by the filter
+	 * @return
+	 */
+	size_t bytes() const
+	{
+		return _blocks.size() * sizeof(Block);
+	}
+
+private:
+	/**
+	 * Pick the block of a mixed hash. The low bits choose the bits inside the
+	 * block, so the block is taken from the top bits of a multiple of it
+	 * @param bits mixed hash
+	 * @return
+	 */
+	size_t _blockIndex(uint64_t bits) const
+	{
+		return (size_t) ((bits * 0x9E3779B97F4A7C15ULL) >> 32) & (_blocks.size() - 1);
+	}
+
+	vector<Block> _blocks;
+};
+
+#ifdef HASHMAP_STATS
+/**
+ * Snapshot of the runtime behaviour of a HashMap, see HashMap::stats().
+ * Only available when compiled with -DHASHMAP_STATS
+ */
+struct HashMapStats
+{
+	/**
+	 * chainHistogram[n] is the amount of buckets holding n pairs
+	 */
+	vector<int> chainHistogram;
+	int maxChain;
+	long grows;
+	long shrinks;
+	/**
+	 * Time spent in resizes, in incremental mode only the part not spread
+	 * over later operations
+	 */
+	double resizeSeconds;
+	long hits;
+	long misses;
+	/**
+	 * Bytes held by the bucket array, the entries of every bucket and the
+	 * Bloom filters
+	 */
+	size_t bytesAllocated;
+};
+#endif
+
 /**
  * Generic class for a HashMap, containing an upper and lower
  * bound for load factors and storing all keys and values in a
  * dynamic array of vectors of pairs (see field "storage")
  * @tparam KeyT type of key
  * @tparam ValueT type of value
+ * @tparam Hash hash functor for keys
+ * @tparam KeyEqual equality functor for keys
+ * @tparam CacheHash whether to store the hash of every key next to its pair
+ * @tparam Allocator allocator for the buckets and their entries
  */
-template <class KeyT, class ValueT>
+template <class KeyT, class ValueT, class Hash = KeyHash<KeyT>, class KeyEqual = std::equal_to<>,
+          bool CacheHash = false, class Allocator = std::allocator<pair<KeyT, ValueT>>>
 class HashMap
 {
+	typedef HashEntry<KeyT, ValueT, CacheHash> Entry;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Entry> EntryAlloc;
+	typedef vector<Entry, EntryAlloc> Bucket;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Bucket> BucketAlloc;
+	typedef std::allocator_traits<BucketAlloc> BucketTraits;
+
+	/**
+	 * With a monotonic allocator and trivially destructible pairs, destroying
+	 * buckets would only call a deallocate() that does nothing, so storage is
+	 * dropped without visiting every bucket
+	 */
+	static constexpr bool DROP_STORAGE = isMonotonic<Allocator>::value &&
+	                                     std::is_trivially_destructible<Entry>::value;
+
+	/**
+	 * Enables the lookup overloads taking a key of type K other than KeyT,
+	 * only available when both the hash and the equality are transparent
+	 */
+	template <class K>
+	using heterogeneousKey = typename std::enable_if<isTransparent<Hash>::value &&
+	                                                 isTransparent<KeyEqual>::value &&
+	                                                 !std::is_same<K, KeyT>::value, int>::type;
+
 public:
+	typedef pair<KeyT, ValueT> value_type;
+
+	/**
+	 * Constructor that receives upper and lower load factors
+	 * @param dUpper upper bound
+	 * @param dLower lower bound
+	 * @param hasher hash functor for keys
+	 * @param keyEqual equality functor for keys
+	 * @param alloc allocator for the storage
+	 */
+	HashMap(double dLower, double dUpper, const Hash &hasher = Hash(), const KeyEqual &keyEqual = KeyEqual(),
+	        const Allocator &alloc = Allocator()):
+			_alloc(alloc),
+			_hasher(hasher),
+			_keyEqual(keyEqual),
+			_policy(dLower, dUpper),
+			_iSize(DEF_SIZE),
+			_iCapacity(DEF_CAP),
+			_bIncremental(false),
+			_iOldCapacity(0),
+			_iMigrated(0),
+			_iMigrateStep(REHASH_STEP),
+			_oldStorage(nullptr),
+			_bBloom(false),
+			_iBloomErased(0)
+	{
+		_storage = _newBuckets(_iCapacity);
+	}
+
+	/**
+	 * Default constructor, empty HashMap with
+	 * fUpper = 0.75 and fLower = 0.25
+	 */
+	HashMap(): HashMap(DEF_LOWER, DEF_UPPER) {}
+
+	/**
+	 * Constructor for an empty HashMap with default load factors that
+	 * allocates through alloc, e.g. an ArenaAllocator
+	 * @param alloc allocator for the storage
+	 */
+	explicit HashMap(const Allocator &alloc): HashMap(DEF_LOWER, DEF_UPPER, Hash(), KeyEqual(), alloc) {}
+
+	/**
+	 * Constructor for an empty HashMap that resizes according to policy
+	 * @param policy see GrowthPolicy
+	 */
+	explicit HashMap(const GrowthPolicy &policy): HashMap(policy.dLower, policy.dUpper)
+	{
+		setGrowthPolicy(policy);
+	}
+
+	/**
+	 * Constructor that receives a key vector and a value vector,
+	 * creates HashMap of keys and values with corresponding indices
+	 * @param keyVec vector of keys
+	 * @param valVec vector of values
+	 */
+	HashMap(const vector<KeyT> &keyVec, const vector<ValueT> &valVec): HashMap()
+	{
+		if(keyVec.size() == valVec.size())
+		{
+			reserve((int) keyVec.size());
+			for(unsigned long i = 0; i < keyVec.size(); ++i)
+			{
+				_insertReserved(keyVec[i], valVec[i]);
+			}
+		}
+		else
+		{
+			throw differentVectorSizes("Vectors are of different sizes");
+		}
+	}
+
+	/**
+	 * Constructor that receives a range of pairs, sized for the whole range
+	 * up front when its length is known
+	 * @param first iterator to the first pair
+	 * @param last iterator past the last pair
+	 */
+	template <class InputIt, class = typename std::iterator_traits<InputIt>::iterator_category>
+	HashMap(InputIt first, InputIt last): HashMap()
+	{
+		insert(first, last);
+	}
+
+	/**
+	 * Constructor that receives a list of pairs, sized for the whole list up front
+	 * @param items pairs to insert
+	 */
+	HashMap(std::initializer_list<value_type> items): HashMap()
+	{
+		insert(items.begin(), items.end());
+	}
+
+	/**
+	 * Copy constructor
+	 * @param other
+	 */
+	HashMap(const HashMap &other):
+	        _alloc(BucketTraits::select_on_container_copy_construction(other._alloc)),
+	        _hasher(other._hasher),
+	        _keyEqual(other._keyEqual),
+	        _policy(other._policy),
+	        _iSize(other._iSize),
+	        _iCapacity(other._iCapacity),
+	        _bIncremental(other._bIncremental),
+	        _iOldCapacity(0),
+	        _iMigrated(0),
+	        _iMigrateStep(REHASH_STEP),
+	        _oldStorage(nullptr),
+	        _bBloom(other._bBloom),
+	        _iBloomErased(0)
+	{
+		_storage = _newBuckets(_iCapacity);
+
+		for(int i = 0; i < _iCapacity; ++i)
+		{
+			for(unsigned long j = 0; j < other._storage[i].size(); ++j)
+			{
+				_storage[i].push_back(other._storage[i][j]);
+			}
+		}
+
+		/* Pairs other has not migrated yet go straight to their new bucket */
+		for(int i = other._iMigrated; i < other._iOldCapacity; ++i)
+		{
+			for(unsigned long j = 0; j < other._oldStorage[i].size(); ++j)
+			{
+				const Entry &entry = other._oldStorage[i][j];
+				_storage[entry.hash(_hasher) & (_iCapacity - 1)].push_back(entry);
+			}
+		}
+
+		if(_bBloom)
+		{
+			_rebuildBloom();
+		}
+	}
+
+	/**
+	 * Move constructor, steals the storage of other and leaves it empty
+	 * without storage. Storage is allocated again on its next insertion
+	 * @param other
+	 */
+	HashMap(HashMap &&other) noexcept:
+			_alloc(std::move(other._alloc)),
+			_hasher(other._hasher),
+			_keyEqual(other._keyEqual),
+			_policy(other._policy),
+			_iSize(other._iSize),
+			_iCapacity(other._iCapacity),
+			_storage(other._storage),
+			_bIncremental(other._bIncremental),
+			_iOldCapacity(other._iOldCapacity),
+			_iMigrated(other._iMigrated),
+			_iMigrateStep(other._iMigrateStep),
+			_oldStorage(other._oldStorage),
+			_bBloom(other._bBloom),
+			_iBloomErased(other._iBloomErased),
+			_bloom(std::move(other._bloom)),
+			_oldBloom(std::move(other._oldBloom))
+	{
+#ifdef HASHMAP_STATS
+		_stats = std::move(other._stats);
+#endif
+		other._release();
+	}
+
+	/**
+	 * Destructor
+	 */
+	~HashMap()
+	{
+		_deleteBuckets(_storage, _iCapacity);
+		_deleteBuckets(_oldStorage, _iOldCapacity);
+	}
+
+	/**
+	 * Get amount of cells currently occupied
+	 * @return
+	 */
+	int size() const
+	{
+		return _iSize;
+	}
+
+	/**
+	 * Get the amount of elements the map is capable of storing
+	 * @return
+	 */
+	int capacity() const
+	{
+		return _iCapacity;
+	}
+
+	/**
+	 * Get current load factor (size / capacity)
+	 * @return
+	 */
+	double getLoadFactor() const
+	{
+		return _iCapacity == 0 ? 0 : (double)_iSize / _iCapacity;
+	}
+
+	/**
+	 * Check if map is empty
+	 * @return true if empty, otherwise false
+	 */
+	bool empty() const
+	{
+		return _iSize == 0;
+	}
+
+#ifdef HASHMAP_STATS
+	/**
+	 * Get chain lengths, resize counts and timing, lookup hits and misses and
+	 * allocated bytes. Chains and bytes are measured now, the counters cover
+	 * everything since construction or the last resetStats(). Hits and misses
+	 * count every key lookup: reads, the lookup ahead of an insertion, erase()
+	 * and merge()
+	 * @return
+	 */
+	HashMapStats stats() const
+	{
+		HashMapStats stats;
+		stats.maxChain = 0;
+		stats.bytesAllocated = (_iCapacity + _iOldCapacity) * sizeof(Bucket) + _bloom.bytes() + _oldBloom.bytes();
+		for(int i = 0; i < _iCapacity + _iOldCapacity; ++i)
+		{
+			const Bucket &bucket = i < _iCapacity ? _storage[i] : _oldStorage[i - _iCapacity];
+			int chain = (int) bucket.size();
+			if(chain >= (int) stats.chainHistogram.size())
+			{
+				stats.chainHistogram.resize(chain + 1, 0);
+			}
+
+			stats.chainHistogram[chain]++;
+			stats.maxChain = chain > stats.maxChain ? chain : stats.maxChain;
+			stats.bytesAllocated += bucket.capacity() * sizeof(Entry);
+		}
+
+		stats.grows = _stats.grows;
+		stats.shrinks = _stats.shrinks;
+		stats.resizeSeconds = _stats.resizeSeconds;
+		stats.hits = _stats.hits;
+		stats.misses = _stats.misses;
+		return stats;
+	}
+
+	/**
+	 * Zero the counters reported by stats()
+	 */
+	void resetStats()
+	{
+		_stats = StatCounters();
+	}
+#endif
+
+	/**
+	 * Check if map contains given key
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool containsKey(const KeyT &key) const
+	{
+		return _locate(key, _hash(key)) != nullptr;
+	}
+
+	/**
+	 * Check if map contains a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool containsKey(const K &key) const
+	{
+		return _locate(key, _hash(key)) != nullptr;
+	}
+
+	/**
+	 * Look up the value bound to key with a single hash and bucket scan
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present. The pointer
+	 * is invalidated by any later insertion or erasure
+	 */
+	ValueT* find(const KeyT &key)
+	{
+		return _findValue(key);
+	}
+
+	/**
+	 * Look up the value bound to key with a single hash and bucket scan
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	const ValueT* find(const KeyT &key) const
+	{
+		return _findValue(key);
+	}
+
+	/**
+	 * Look up the value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	ValueT* find(const K &key)
+	{
+		return _findValue(key);
+	}
+
+	/**
+	 * Look up the value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	const ValueT* find(const K &key) const
+	{
+		return _findValue(key);
+	}
+
+	/**
+	 * Look up a batch of keys at once. The keys are hashed and their buckets
+	 * prefetched BATCH_SIZE at a time before any bucket is scanned, so the
+	 * cache misses of independent lookups overlap instead of being paid one
+	 * after the other
+	 * @param keys keys to look up
+	 * @param amount amount of keys
+	 * @param values set to the result of find() for every key
+	 */
+	void find_batch(const KeyT *keys, size_t amount, const ValueT **values) const
+	{
+		_lookupBatch(keys, amount, [values](size_t i, const Entry *entry)
+		{
+			values[i] = entry == nullptr ? nullptr : &entry -> item.second;
+		});
+	}
+
+	/**
+	 * Same as find_batch(const KeyT*, size_t, const ValueT**), for keys of a
+	 * type other than KeyT
+	 * @param keys keys to look up, e.g. std::string_views for string keys
+	 * @param amount amount of keys
+	 * @param values set to the result of find() for every key
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	void find_batch(const K *keys, size_t amount, const ValueT **values) const
+	{
+		_lookupBatch(keys, amount, [values](size_t i, const Entry *entry)
+		{
+			values[i] = entry == nullptr ? nullptr : &entry -> item.second;
+		});
+	}
+
+	/**
+	 * Check a batch of keys at once, see find_batch()
+	 * @param keys keys to look up
+	 * @param amount amount of keys
+	 * @param results set to the result of containsKey() for every key
+	 */
+	void contains_batch(const KeyT *keys, size_t amount, bool *results) const
+	{
+		_lookupBatch(keys, amount, [results](size_t i, const Entry *entry)
+		{
+			results[i] = entry != nullptr;
+		});
+	}
+
+	/**
+	 * Check a batch of keys of a type other than KeyT at once, see find_batch()
+	 * @param keys keys to look up, e.g. std::string_views for string keys
+	 * @param amount amount of keys
+	 * @param results set to the result of containsKey() for every key
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	void contains_batch(const K *keys, size_t amount, bool *results) const
+	{
+		_lookupBatch(keys, amount, [results](size_t i, const Entry *entry)
+		{
+			results[i] = entry != nullptr;
+		});
+	}
+
+	/**
+	 * Resize storage array according to upper and lower bounds
+	 * of load factor. In incremental mode this only allocates the new
+	 * storage, and the pairs are moved over by later inserts and erases
+	 * @param factor factor by which to resize
+	 */
+	void resize(double factor)
+	{
+		_rehashTo((int) (_iCapacity * factor));
+	}
+
+	/**
+	 * Grow the storage so that amount pairs fit without exceeding the upper
+	 * load factor, so inserting them never resizes. Never shrinks
+	 * @param amount amount of pairs the map should be able to hold
+	 */
+	void reserve(int amount)
+	{
+		int newSize = _policy.fitCapacity(amount);
+		if(newSize > _iCapacity)
+		{
+			_rehashTo(newSize);
+		}
+	}
+
+	/**
+	 * Shrink the storage to the least capacity the growth policy allows for
+	 * the current pairs. Never grows
+	 */
+	void shrink_to_fit()
+	{
+		int newSize = _policy.fitCapacity(_iSize);
+		if(newSize < _iCapacity)
+		{
+			_rehashTo(newSize);
+		}
+	}
+
+	/**
+	 * Get the policy deciding when the map resizes
+	 * @return
+	 */
+	const GrowthPolicy& growthPolicy() const
+	{
+		return _policy;
+	}
+
+	/**
+	 * Replace the policy deciding when the map resizes. Grows the storage
+	 * right away if it is under the capacity floor of policy
+	 * @param policy see GrowthPolicy
+	 */
+	void setGrowthPolicy(const GrowthPolicy &policy)
+	{
+		_policy = policy;
+		if(_iCapacity > 0)
+		{
+			reserve(_iSize);
+		}
+
+		if(isRehashing())
+		{
+			_iMigrateStep = _migrationStep();
+		}
+	}
+
+	/**
+	 * Turn incremental rehashing on or off. When on, a resize only allocates
+	 * the new storage, each later insert or erase moves at least REHASH_STEP
+	 * buckets of the old storage into it and lookups consult both, so no
+	 * single operation pays for rehashing the whole map. Each operation moves
+	 * enough buckets that the old storage is empty before the growth policy
+	 * can resize the map again, so only an explicit resize(), reserve() or
+	 * shrink_to_fit() in the middle of a rehash has to finish it at once.
+	 * Turning it off finishes any rehash in progress
+	 * @param enabled true to rehash incrementally
+	 */
+	void setIncrementalRehash(bool enabled)
+	{
+		_bIncremental = enabled;
+		if(!enabled)
+		{
+			_finishRehash();
+		}
+	}
+
+	/**
+	 * Check if an incremental rehash is in progress
+	 * @return true if some pairs are still in the old storage, otherwise false
+	 */
+	bool isRehashing() const
+	{
+		return _oldStorage != nullptr;
+	}
+
+	/**
+	 * Turn the Bloom filter in front of the buckets on or off. When on, every
+	 * lookup first checks a blocked Bloom filter of BLOOM_BITS_PER_BUCKET bits
+	 * per bucket, so most lookups of absent keys read one cache line and
+	 * never touch a bucket. Worth it when most lookups miss. Erased keys stay
+	 * in the filter until it is rebuilt, which happens on every resize and
+	 * after capacity / 2 erasures
+	 * @param enabled true to filter lookups
+	 */
+	void setBloomFilter(bool enabled)
+	{
+		_bBloom = enabled;
+		if(enabled)
+		{
+			_rebuildBloom();
+		}
+		else
+		{
+			_bloom.release();
+			_oldBloom.release();
+		}
+	}
+
+	/**
+	 * Insert given item to map
+	 * @param item item to be inserted
+	 * @return true if successfully inserted, otherwise false
+	 */
+	bool insert(KeyT key, ValueT value)
+	{
+		return try_emplace(std::move(key), std::move(value)).second;
+	}
+
+	/**
+	 * Insert given pair to map, moving it into storage
+	 * @param item item to be inserted
+	 * @return true if successfully inserted, otherwise false
+	 */
+	bool insert(value_type &&item)
+	{
+		size_t hash = _hash(item.first);
+		if(_locate(item.first, hash) != nullptr)
+		{
+			return false;
+		}
+
+		_emplaceNew(hash, std::move(item));
+		return true;
+	}
+
+	/**
+	 * Insert a range of pairs, skipping those whose key is already present.
+	 * When the length of the range is known the storage is sized for all of
+	 * it once, and the pairs are placed without per pair load checks
+	 * @param first iterator to the first pair
+	 * @param last iterator past the last pair
+	 */
+	template <class InputIt, class = typename std::iterator_traits<InputIt>::iterator_category>
+	void insert(InputIt first, InputIt last)
+	{
+		typedef typename std::iterator_traits<InputIt>::iterator_category category;
+		if constexpr(std::is_base_of<std::forward_iterator_tag, category>::value)
+		{
+			reserve(_iSize + (int) std::distance(first, last));
+			for(; first != last; ++first)
+			{
+				_insertReserved(first -> first, first -> second);
+			}
+		}
+		else
+		{
+			for(; first != last; ++first)
+			{
+				insert(first -> first, first -> second);
+			}
+		}
+	}
+
+	/**
+	 * Construct a pair from args in place and insert it if its key is not
+	 * present. Prefer try_emplace() when the key is at hand, since it does not
+	 * build the value for keys that are already present
+	 * @param args arguments forwarded to the constructor of value_type
+	 * @return pointer to the value bound to the key and true if it was
+	 * inserted, false if the key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> emplace(Args&&... args)
+	{
+		value_type item(std::forward<Args>(args)...);
+		size_t hash = _hash(item.first);
+		Entry *found = _locate(item.first, hash);
+		if(found != nullptr)
+		{
+			return pair<ValueT*, bool>(&found -> item.second, false);
+		}
+
+		return pair<ValueT*, bool>(&_emplaceNew(hash, std::move(item)) -> item.second, true);
+	}
+
+	/**
+	 * Insert a value constructed from args if key is not present, otherwise
+	 * leave the map untouched. Hashes key and scans its bucket once
+	 * @param key key to look up
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and true if it was inserted,
+	 * false if key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> try_emplace(const KeyT &key, Args&&... args)
+	{
+		return _tryEmplace(key, std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Same as try_emplace(const KeyT&, Args&&...), but moves key into the map
+	 * if it is inserted
+	 * @param key key to look up
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and true if it was inserted,
+	 * false if key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> try_emplace(KeyT &&key, Args&&... args)
+	{
+		return _tryEmplace(std::move(key), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Bind value to key, overwriting the current value if key is present
+	 * @param key key to assign
+	 * @param value value to bind
+	 * @return true if key was inserted, false if an existing value was assigned
+	 */
+	bool insert_or_assign(const KeyT &key, const ValueT &value)
+	{
+		pair<ValueT*, bool> result = try_emplace(key, value);
+		if(!result.second)
+		{
+			*result.first = value;
+		}
+
+		return result.second;
+	}
+
+	/**
+	 * Insert every pair of other, and for keys present in both maps replace
+	 * the value with combine(this value, other value). Storage is reserved
+	 * for both maps up front. When both maps end up with the same capacity,
+	 * every bucket of other merges into the bucket of the same index here,
+	 * so keys are never hashed
+	 * @param other map to merge from, hashed like this map
+	 * @param combine callable taking two values and returning their merge
+	 */
+	template <class Combine>
+	void merge(const HashMap &other, Combine combine)
+	{
+		if(this == &other)
+		{
+			HashMap copy(other);
+			merge(copy, combine);
+			return;
+		}
+
+		/* The whole storage has to be in place before buckets are merged into directly */
+		reserve(_iSize + other._iSize);
+		_finishRehash();
+
+		if(_iCapacity == other._iCapacity && !other.isRehashing())
+		{
+			for(int i = 0; i < _iCapacity; ++i)
+			{
+				for(const Entry &entry: other._storage[i])
+				{
+					size_t hash = 0;
+					if constexpr(CacheHash)
+					{
+						hash = entry.cachedHash;
+					}
+
+					_iSize += _combineInto(_storage[i], hash, entry.item.first, entry.item.second, combine);
+				}
+			}
+		}
+		else
+		{
+			for(int i = 0; i < other._iCapacity + other._iOldCapacity; ++i)
+			{
+				const Bucket &bucket = i < other._iCapacity ? other._storage[i]
+				                                            : other._oldStorage[i - other._iCapacity];
+				for(const Entry &entry: bucket)
+				{
+					size_t hash = entry.hash(_hasher);
+					_iSize += _combineInto(_storage[hash & (_iCapacity - 1)], hash, entry.item.first,
+					                       entry.item.second, combine);
+				}
+			}
+		}
+
+		if(_bBloom)
+		{
+			_rebuildBloom();
+		}
+	}
+
+	/**
+	 * Merge maps into a new map on threads, e.g. the counting maps of
+	 * parallel scans. Every thread owns the buckets of the new map whose
+	 * index is equal to its number modulo the amount of threads, and since
+	 * all capacities are powers of two it finds the pairs for those buckets
+	 * in the matching buckets of every input map. Each thread therefore
+	 * reads and writes only its own share of the pairs, without locking and
+	 * without a second pass. The new map takes the hash, equality, growth
+	 * policy and Bloom filter setting of the first map, all maps must hash
+	 * alike. Not available for monotonic allocators, whose arenas are not
+	 * thread safe
+	 * @param maps maps to merge
+	 * @param threads amount of threads, rounded down to a power of two
+	 * @param combine callable taking two values and returning their merge,
+	 * called concurrently for different keys. An exception it throws on any
+	 * thread is rethrown here once every thread is done
+	 * @return
+	 */
+	template <class Combine>
+	static HashMap mergeParallel(const vector<HashMap> &maps, int threads, Combine combine)
+	{
+		static_assert(!isMonotonic<Allocator>::value, "Arena allocators can't be shared between threads");
+
+		HashMap result;
+		int total = 0;
+		for(const HashMap &map: maps)
+		{
+			total += map._iSize;
+		}
+
+		if(!maps.empty())
+		{
+			result._hasher = maps[0]._hasher;
+			result._keyEqual = maps[0]._keyEqual;
+			result._policy = maps[0]._policy;
+		}
+
+		result.reserve(total);
+		int parts = result._partitions(threads);
+		vector<int> inserted(parts, 0);
+
+		_runParallel(parts, [&](int part)
+		{
+			int count = 0;
+			for(const HashMap &map: maps)
+			{
+				for(int i = 0; i < map._iCapacity + map._iOldCapacity; ++i)
+				{
+					bool isOld = i >= map._iCapacity;
+					int bucketAmt = isOld ? map._iOldCapacity : map._iCapacity;
+					int idx = isOld ? i - map._iCapacity : i;
+
+					/* Buckets of a storage at least parts wide belong to a single thread */
+					if(bucketAmt >= parts && (idx & (parts - 1)) != part)
+					{
+						continue;
+					}
+
+					for(const Entry &entry: isOld ? map._oldStorage[idx] : map._storage[idx])
+					{
+						size_t hash = entry.hash(result._hasher);
+						if((int) (hash & (parts - 1)) == part)
+						{
+							count += result._combineInto(result._storage[hash & (result._iCapacity - 1)],
+							                             hash, entry.item.first, entry.item.second, combine);
+						}
+					}
+				}
+			}
+
+			inserted[part] = count;
+		});
+
+		for(int part = 0; part < parts; ++part)
+		{
+			result._iSize += inserted[part];
+		}
+
+		if(!maps.empty() && maps[0]._bBloom)
+		{
+			result.setBloomFilter(true);
+		}
+
+		return result;
+	}
+
+	/**
+	 * Build a map from a range of pairs on threads. The pairs are hashed in
+	 * parallel and sorted by the low bits of their hash into one list per
+	 * thread, then every thread inserts its lists straight into the buckets
+	 * it owns (see mergeParallel()), which were sized for the whole range up
+	 * front. Not available for monotonic allocators
+	 * @param first iterator to the first pair
+	 * @param last iterator past the last pair
+	 * @param threads amount of threads, rounded down to a power of two
+	 * @param combine callable taking two values and returning their merge,
+	 * applied to the values of repeated keys in no particular order, called
+	 * concurrently for different keys. An exception it throws on any thread
+	 * is rethrown here once every thread is done
+	 * @param hasher hash functor of the new map, e.g. a seeded KeyHash
+	 * @param keyEqual equality functor of the new map
+	 * @return
+	 */
+	template <class RandomIt, class Combine>
+	static HashMap buildParallel(RandomIt first, RandomIt last, int threads, Combine combine,
+	                             const Hash &hasher = Hash(), const KeyEqual &keyEqual = KeyEqual())
+	{
+		static_assert(!isMonotonic<Allocator>::value, "Arena allocators can't be shared between threads");
+
+		size_t amount = last - first;
+		HashMap result(DEF_LOWER, DEF_UPPER, hasher, keyEqual);
+		result.reserve((int) amount);
+		int parts = result._partitions(threads);
+
+		vector<size_t> hashes(amount);
+		vector<vector<size_t>> lists(parts * parts);
+
+		/* Thread t hashes the t-th chunk of the range into lists[t * parts + part] */
+		_runParallel(parts, [&](int chunk)
+		{
+			size_t begin = amount * chunk / parts;
+			size_t end = amount * (chunk + 1) / parts;
+			for(size_t i = begin; i < end; ++i)
+			{
+				hashes[i] = result._hash(first[i].first);
+				lists[chunk * parts + (hashes[i] & (parts - 1))].push_back(i);
+			}
+		});
+
+		vector<int> inserted(parts, 0);
+		_runParallel(parts, [&](int part)
+		{
+			int count = 0;
+			for(int chunk = 0; chunk < parts; ++chunk)
+			{
+				for(size_t i: lists[chunk * parts + part])
+				{
+					count += result._combineInto(result._storage[hashes[i] & (result._iCapacity - 1)],
+					                             hashes[i], first[i].first, first[i].second, combine);
+				}
+			}
+
+			inserted[part] = count;
+		});
+
+		for(int part = 0; part < parts; ++part)
+		{
+			result._iSize += inserted[part];
+		}
+
+		return result;
+	}
+
+	/**
+	 * Get value at key in map. Throws exception if key not present
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
+	 */
+	ValueT at(const KeyT &key) const
+	{
+		return _at(key);
+	}
+
+	/**
+	 * Get value at a key equal to key, without converting it to KeyT. Throws
+	 * exception if key not present
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return value bound to key, or exception if key not found
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	ValueT at(const K &key) const
+	{
+		return _at(key);
+	}
+	
+	/**
+	 * Erase value bound to key
+	 * @param key key to look up
+	 * @return true if value successfully erased, otherwise false
+	 */
+	bool erase(const KeyT &key)
+	{
+		return _erase(key);
+	}
+
+	/**
+	 * Erase value bound to a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if value successfully erased, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool erase(const K &key)
+	{
+		return _erase(key);
+	}
+
+	/**
+	 * Get size of vector that contains key
+	 * @param key key to look up
+	 * @return
+	 */
+	int bucketSize(const KeyT &key) const
+	{
+		return _bucketSize(_hash(key));
+	}
+
+	/**
+	 * Get size of vector that would contain key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	int bucketSize(const K &key) const
+	{
+		return _bucketSize(_hash(key));
+	}
+
+	/**
+	 * Erase all pairs from map. With a monotonic allocator and trivially
+	 * destructible pairs this is O(1): the storage is dropped and a new one at
+	 * the capacity floor of the growth policy is taken from the arena
+	 */
+	void clear()
+	{
+		if(DROP_STORAGE)
+		{
+			_deleteBuckets(_storage, _iCapacity);
+			_iCapacity = _policy.iMinCapacity;
+			_storage = _newBuckets(_iCapacity);
+		}
+		else
+		{
+			for(int vIdx = 0; vIdx < _iCapacity; ++vIdx)
+			{
+				_storage[vIdx].clear();
+			}
+		}
+
+		_deleteBuckets(_oldStorage, _iOldCapacity);
+		_oldStorage = nullptr;
+		_iOldCapacity = 0;
+		_iMigrated = 0;
+		_iSize = DEF_SIZE;
 
+		if(_bBloom)
+		{
+			_rebuildBloom();
+		}
+	}
+	
 	/**
-	 * Constructor that receives upper and lower load factors
-	 * @param dUpper upper bound
-	 * @param dLower lower bound
+	 * Overload for = operator, deep copies other
+	 * @param other HashMap to copy
+	 * @return reference to HashMap
 	 */
-	HashMap<KeyT, ValueT>(double dLower, double dUpper):
-			_dLower(dLower),
-			_dUpper(dUpper),
-			_iSize(DEF_SIZE),
-			_iCapacity(DEF_CAP)
+	HashMap& operator=(const HashMap &other)
 	{
-		_storage = new vector<pair<KeyT, ValueT>>[_iCapacity];
+		if(this != &other)
+		{
+			*this = HashMap(other);
+		}
+
+		return *this;
 	}
 
 	/**
-	 * Default constructor, empty HashMap with
-	 * fUpper = 0.75 and fLower = 0.25
+	 * Overload for move = operator, frees current storage and steals the
+	 * storage of other
+	 * @param other HashMap to move from
+	 * @return reference to HashMap
 	 */
-	HashMap<KeyT, ValueT>(): HashMap(DEF_LOWER, DEF_UPPER) {}
+	HashMap& operator=(HashMap &&other) noexcept
+	{
+		if(this != &other)
+		{
+			_deleteBuckets(_storage, _iCapacity);
+			_deleteBuckets(_oldStorage, _iOldCapacity);
+			_alloc = std::move(other._alloc);
+			_hasher = other._hasher;
+			_keyEqual = other._keyEqual;
+			_policy = other._policy;
+			_iSize = other._iSize;
+			_iCapacity = other._iCapacity;
+			_storage = other._storage;
+			_bIncremental = other._bIncremental;
+			_iOldCapacity = other._iOldCapacity;
+			_iMigrated = other._iMigrated;
+			_iMigrateStep = other._iMigrateStep;
+			_oldStorage = other._oldStorage;
+			_bBloom = other._bBloom;
+			_iBloomErased = other._iBloomErased;
+			_bloom = std::move(other._bloom);
+			_oldBloom = std::move(other._oldBloom);
+#ifdef HASHMAP_STATS
+			_stats = std::move(other._stats);
+#endif
+			other._release();
+		}
+
+		return *this;
+	}
 
 	/**
-	 * Constructor that receives a key vector and a value vector,
-	 * creates HashMap of keys and values with corresponding indices
-	 * @param keyVec vector of keys
-	 * @param valVec vector of values
+	 * Overload for [] operator, returns value corresponding to given key.
+	 * Throws exception if key not present
+	 * @param key key to look up
+	 * @return value attached to key
 	 */
-	HashMap<KeyT, ValueT>(vector<KeyT> keyVec, vector<ValueT> valVec): HashMap()
+	const ValueT& operator[](const KeyT &key) const
 	{
-		if(keyVec.size() == valVec.size())
-		{
-			for(unsigned long i = 0; i < keyVec.size(); ++i)
-			{
-				insert(keyVec[i], valVec[i]);
-			}
-		}
-		else
+		const ValueT *value = find(key);
+		if(value == nullptr)
 		{
-			throw differentVectorSizes("Vectors are of different sizes");
+			throw invalidKeyException("Key not present in map");
 		}
+
+		return *value;
 	}
 
 	/**
-	 * Copy constructor
-	 * @param other
+	 * Overload for [] operator, creates new pair if key not present
+	 * @param key key to assign
+	 * @return reference to value
 	 */
-	HashMap<KeyT, ValueT>(const HashMap<KeyT, ValueT> &other):
-	        _dUpper(other._dUpper),
-	        _dLower(other._dLower),
-	        _iSize(other._iSize),
-	        _iCapacity(other._iCapacity)
+	ValueT& operator[](const KeyT &key)
 	{
-		_storage = new vector<pair<KeyT, ValueT>>[_iCapacity];
+		return *try_emplace(key).first;
+	}
 
-		for(int i = 0; i < _iCapacity; ++i)
+	/**
+	 * Overload for == operator, checks that all fields are equal
+	 * @param other HashMap to compare to
+	 * @return true if all fields are equal, otherwise false
+	 */
+	bool operator==(const HashMap &other) const
+	{
+		if(_iSize != other._iSize ||
+		   _iCapacity != other._iCapacity ||
+		   _policy.dUpper != other._policy.dUpper ||
+		   _policy.dLower != other._policy.dLower)
 		{
-			for(unsigned long j = 0; j < other._storage[i].size(); ++j)
+			return false;
+		}
+
+		for(const auto &item: other)
+		{
+			const ValueT *value = find(item.first);
+			if(value == nullptr || item.second != *value)
 			{
-				_storage[i].push_back(other._storage[i][j]);
+				return false;
 			}
 		}
+
+		return true;
 	}
 
 	/**
-	 * Move constructor
-	 * @param other
+	 * Overload for != operator
+	 * @param other HashMap to compare to
+	 * @return opposite of ==
 	 */
-	HashMap<KeyT, ValueT>(const HashMap<KeyT, ValueT> && other) noexcept:
-			_dUpper(other._dUpper),
-			_dLower(other._dLower),
-			_iSize(other._iSize),
-			_iCapacity(other._iCapacity)
+	bool operator!=(const HashMap &other) const
 	{
-		for(int i = 0; i < _iCapacity; ++i)
+		return  !(operator==(other));
+	}
+
+	/**
+	 * Nested Iterator class. Walks the buckets of the storage in order, and
+	 * during an incremental rehash continues with the buckets of the old
+	 * storage that have not been migrated yet
+	 */
+	class const_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef pair<KeyT, ValueT> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const value_type* pointer;
+		typedef const value_type& reference;
+
+		/**
+		 * Constructor that accepts the map over which it iterates
+		 * @param map map to iterate
+		 * @param curVec bucket to start from, amount of buckets for end()
+		 */
+		explicit const_iterator(const HashMap *map, int curVec = 0):
+				_map(map),
+				_curVec(curVec),
+				_curPair(0),
+				_vecAmt(map -> _iCapacity + map -> _iOldCapacity)
 		{
-			for(unsigned long j = 0; j < other._storage[i].size(); ++j)
+			_skipEmpty();
+		}
+
+		/**
+		 * Prefix increment operator that holds the logic of iterating over the elements in the map
+		 * @return next element in iteration
+		 */
+		const_iterator& operator++()
+		{
+			++_curPair;
+			_skipEmpty();
+			return *this;
+		}
+
+		/**
+		 * Postfix increment operator
+		 * @return element before the increment
+		 */
+		const const_iterator operator++(int)
+		{
+			const_iterator temp = *this;
+			operator++();
+			return temp;
+		}
+
+		/**
+		 * Overload for dereference * operator
+		 * @return the item in the map to which the iterator points
+		 */
+		const pair<KeyT, ValueT>& operator*() const
+		{
+			return _bucket()[_curPair].item;
+		}
+
+		/**
+		 * Overload for -> operator
+		 * @return
+		 */
+		const pair<KeyT, ValueT>* operator->() const
+		{
+			return &_bucket()[_curPair].item;
+		}
+
+		/**
+		 * Overload for == operator
+		 * @param other iterator to compare to
+		 * @return true if iterators point to the same location, otherwise false
+		 */
+		bool operator==(const const_iterator &other) const
+		{
+			return _curVec == other._curVec && _curPair == other._curPair;
+		}
+
+		/**
+		 * Overload for != operator
+		 * @param other iterator to compare to
+		 * @return opposite of ==
+		 */
+		bool operator!=(const const_iterator &other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		/**
+		 * Get the bucket the iterator is in, buckets past the capacity of the
+		 * map belong to the old storage
+		 * @return
+		 */
+		const Bucket& _bucket() const
+		{
+			if(_curVec < _map -> _iCapacity)
 			{
-				_storage[i].push_back(other._storage[i][j]);
+				return _map -> _storage[_curVec];
 			}
+
+			return _map -> _oldStorage[_curVec - _map -> _iCapacity];
 		}
-	}
+
+		/**
+		 * Move on from vector to vector until the iterator points at a pair,
+		 * or at the end
+		 */
+		void _skipEmpty()
+		{
+			while(_curVec < _vecAmt && _curPair == _bucket().size())
+			{
+				++_curVec;
+				_curPair = 0;
+			}
+		}
+
+		const HashMap *_map;
+		int _curVec;
+		unsigned long _curPair;
+		int _vecAmt;
+	};
 
 	/**
-	 * Destructor
+	 * Returns first element in iteration
+	 * @return
 	 */
-	~HashMap<KeyT, ValueT>()
+	const_iterator begin() const
 	{
-		delete[] _storage;
+		return const_iterator(this);
 	}
 
 	/**
-	 * Get amount of cells currently occupied
+	 * Returns the element "one after the last"
 	 * @return
 	 */
-	int size() const
+	const_iterator end() const
 	{
-		return _iSize;
+		return const_iterator(this, _iCapacity + _iOldCapacity);
 	}
-
+	
 	/**
-	 * Get the amount of elements the map is capable of storing
+	 * Returns first element in iteration
 	 * @return
 	 */
-	int capacity() const
+	const_iterator cbegin() const
 	{
-		return _iCapacity;
+		return begin();
+	}
+	
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator cend() const
+	{
+		return end();
 	}
 
+private:
 	/**
-	 * Get current load factor (size / capacity)
+	 * Hash a key, or anything the key hash accepts
+	 * @param key key to hash
 	 * @return
 	 */
-	double getLoadFactor() const
+	template <class K>
+	size_t _hash(const K &key) const
 	{
-		return (double)_iSize / _iCapacity;
+		return _hasher(key);
 	}
 
 	/**
-	 * Check if map is empty
-	 * @return true if empty, otherwise false
+	 * Scan the bucket of hash for key. Every lookup, whether reading or ahead
+	 * of an insertion, passes here and is counted for stats()
+	 * @param key key to look up
+	 * @param hash hash of key
+	 * @return pointer to the pair holding key, or nullptr if not present
 	 */
-	bool empty() const
+	template <class K>
+	Entry* _locate(const K &key, size_t hash) const
 	{
-		return _iSize == 0;
+		if(_iSize == 0)
+		{
+			_countLookup(false);
+			return nullptr;
+		}
+
+		Entry *entry = nullptr;
+		if(!_bBloom || _bloom.mayContain(hash))
+		{
+			entry = _scanBucket(_storage[hash & (_iCapacity - 1)], key, hash);
+		}
+
+		if(entry == nullptr && _oldStorage != nullptr && (!_bBloom || _oldBloom.mayContain(hash)))
+		{
+			entry = _scanBucket(_oldStorage[hash & (_iOldCapacity - 1)], key, hash);
+		}
+
+		_countLookup(entry != nullptr);
+		return entry;
 	}
 
 	/**
-	 * Check if map contains given key
+	 * Count a lookup as a hit or a miss for stats(), compiled out unless
+	 * HASHMAP_STATS is defined
+	 * @param found whether the key was present
+	 */
+	void _countLookup(bool found) const
+	{
+#ifdef HASHMAP_STATS
+		(found ? _stats.hits : _stats.misses).fetch_add(1, std::memory_order_relaxed);
+#else
+		(void) found;
+#endif
+	}
+
+	/**
+	 * Shared implementation of find_batch() and contains_batch(). Works in
+	 * three passes over every BATCH_SIZE keys: hash and prefetch the bucket,
+	 * prefetch the entries of the bucket, then scan. During an incremental
+	 * rehash only the new storage is prefetched
+	 * @param keys keys to look up
+	 * @param amount amount of keys
+	 * @param onResult called with the index of every key and its entry, or
+	 * nullptr if not present
+	 */
+	template <class K, class F>
+	void _lookupBatch(const K *keys, size_t amount, F onResult) const
+	{
+		size_t hashes[BATCH_SIZE];
+		for(size_t start = 0; start < amount; start += BATCH_SIZE)
+		{
+			size_t count = amount - start < BATCH_SIZE ? amount - start : BATCH_SIZE;
+			if(_iSize == 0)
+			{
+				for(size_t i = 0; i < count; ++i)
+				{
+					onResult(start + i, nullptr);
+				}
+
+				continue;
+			}
+
+			for(size_t i = 0; i < count; ++i)
+			{
+				hashes[i] = _hash(keys[start + i]);
+				_prefetch(&_storage[hashes[i] & (_iCapacity - 1)]);
+			}
+
+			for(size_t i = 0; i < count; ++i)
+			{
+				_prefetch(_storage[hashes[i] & (_iCapacity - 1)].data());
+			}
+
+			for(size_t i = 0; i < count; ++i)
+			{
+				onResult(start + i, _locate(keys[start + i], hashes[i]));
+			}
+		}
+	}
+
+	/**
+	 * Hint the CPU to start loading the line holding address, without waiting
+	 * for it. Does nothing on compilers without __builtin_prefetch
+	 * @param address any address, need not be valid
+	 */
+	static void _prefetch(const void *address)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(address);
+#else
+		(void) address;
+#endif
+	}
+
+	/**
+	 * Scan a single bucket for key
+	 * @param bucket bucket to scan
 	 * @param key key to look up
-	 * @return true if key is present in map, otherwise false
+	 * @param hash hash of key
+	 * @return pointer to the entry holding key, or nullptr if not present
 	 */
-	bool containsKey(KeyT key) const
+	template <class K>
+	Entry* _scanBucket(Bucket &bucket, const K &key, size_t hash) const
 	{
-		std::hash<KeyT> keyHasher;
-		size_t newIdx = keyHasher(key) & (_iCapacity - 1);
-		for(unsigned long i = 0; i < _storage[newIdx].size(); ++i)
+		for(unsigned long i = 0; i < bucket.size(); ++i)
 		{
-			if(_storage[newIdx][i].first == key)
+			if(bucket[i].hashMatches(hash) && _keyEqual(bucket[i].item.first, key))
 			{
-				return true;
+				return &bucket[i];
 			}
 		}
 
-		return false;
+		return nullptr;
 	}
 
 	/**
-	 * Resize storage array according to upper and lower bounds
-	 * of load factor
-	 * @param factor factor by which to resize
+	 * Get the amount of pairs in the buckets that hash maps to
+	 * @param hash
+	 * @return
 	 */
-	void resize(double factor)
+	int _bucketSize(size_t hash) const
 	{
-		int newSize = (int) (_iCapacity * factor);
-		auto *newArr = new vector<pair<KeyT, ValueT>>[newSize];
+		if(_iCapacity == 0)
+		{
+			return 0;
+		}
 
-		/* Copy over all items */
-		for(int i = 0; i < _iCapacity; ++i)
+		int size = _storage[hash & (_iCapacity - 1)].size();
+		if(_oldStorage != nullptr)
+		{
+			size += _oldStorage[hash & (_iOldCapacity - 1)].size();
+		}
+
+		return size;
+	}
+
+	/**
+	 * Move all pairs of a bucket that is not part of the storage to their
+	 * bucket in the storage
+	 * @param bucket bucket to empty
+	 */
+	void _migrateBucket(Bucket &bucket)
+	{
+		for(unsigned long j = 0; j < bucket.size(); ++j)
 		{
-			for(unsigned long j = 0; j < _storage[i].size(); ++j)
+			size_t hash = bucket[j].hash(_hasher);
+			_storage[hash & (_iCapacity - 1)].push_back(std::move(bucket[j]));
+			if(_bBloom)
 			{
-				std::hash<KeyT> keyHasher;
-				int newIdx = keyHasher(_storage[i][j].first) & (newSize - 1);
+				_bloom.add(hash);
+			}
+		}
+
+		bucket.clear();
+	}
+
+	/**
+	 * Get how many old buckets each insert or erase migrates: at least
+	 * REHASH_STEP, and enough to empty the old storage before as many
+	 * operations as it takes the policy to grow or shrink the map again.
+	 * Every insertion or erasure migrates before it changes the size, and
+	 * the size moves by one per operation, so the next resize always finds
+	 * the old storage empty
+	 * @return
+	 */
+	int _migrationStep() const
+	{
+		int opsLeft = (int) (_policy.dUpper * _iCapacity) - _iSize;
+		if(_policy.bShrinkOnErase && _iCapacity > _policy.iMinCapacity)
+		{
+			int shrinkOpsLeft = _iSize - (int) (_policy.shrinkLoad() * _iCapacity) - 1;
+			opsLeft = shrinkOpsLeft < opsLeft ? shrinkOpsLeft : opsLeft;
+		}
 
-				newArr[newIdx].push_back(_storage[i][j]);
-			}
+		if(opsLeft < 1)
+		{
+			opsLeft = 1;
 		}
 
-		_iCapacity = newSize;
-		delete[] _storage;
-		_storage = newArr;
+		int step = (_iOldCapacity + opsLeft - 1) / opsLeft;
+		return step > REHASH_STEP ? step : REHASH_STEP;
 	}
 
 	/**
-	 * Insert given item to map
-	 * @param item item to be inserted
-	 * @return true if successfully inserted, otherwise false
+	 * Migrate the next _iMigrateStep buckets of an incremental rehash in
+	 * progress, freeing the old storage once it is empty
 	 */
-	bool insert(KeyT key, ValueT value)
+	void _migrateStep()
 	{
-		if(containsKey(key))
+		if(_oldStorage == nullptr)
 		{
-			return false;
+			return;
 		}
 
-		double ratio = (double) _iSize / _iCapacity;
-		if(ratio >= _dUpper)
+		for(int i = 0; i < _iMigrateStep && _iMigrated < _iOldCapacity; ++i)
 		{
-			resize(UPPER_FACTOR);
+			_migrateBucket(_oldStorage[_iMigrated++]);
 		}
 
-		std::hash<KeyT> keyHasher;
-		//TODO: fix the hashing with unsigned
-		int newIdx = keyHasher(key) & (_iCapacity - 1);
-
-		pair<KeyT, ValueT> item(key, value);
-		_storage[newIdx].push_back(item);
-		_iSize++;
-
-		return true;
+		if(_iMigrated == _iOldCapacity)
+		{
+			_deleteBuckets(_oldStorage, _iOldCapacity);
+			_oldBloom.release();
+			_oldStorage = nullptr;
+			_iOldCapacity = 0;
+			_iMigrated = 0;
+		}
 	}
 
 	/**
-	 * Get value at key in map. Throws exception if key not present
-	 * @param key key to look up
-	 * @return value bound to key, or exception if key not found
+	 * Migrate everything left in an incremental rehash in progress
 	 */
-	ValueT at(KeyT key) const
+	void _finishRehash()
 	{
-		if(containsKey(key))
-		{
-			std::hash<KeyT> keyHasher;
-			size_t newIdx = keyHasher(key) & (_iCapacity - 1);
-			for(unsigned long idx = 0; idx < _storage[newIdx].size(); ++idx)
-			{
-				if(_storage[newIdx][idx].first == key)
-				{
-					return _storage[newIdx][idx].second;
-				}
-			}
-		}
-		else
+		while(_oldStorage != nullptr)
 		{
-			throw invalidKeyException("Key not present in map");
+			_migrateStep();
 		}
-
-		//TODO: handle exception
 	}
-	
+
 	/**
-	 * Erase value bound to key
-	 * @param key key to look up
-	 * @return true if value successfully erased, otherwise false
+	 * Build the Bloom filters from scratch out of the pairs in the storage
+	 * and the old storage, dropping erased keys
 	 */
-	bool erase(KeyT key)
+	void _rebuildBloom()
 	{
-		std::hash<KeyT> keyHash;
-		size_t index = keyHash(key) & (_iCapacity - 1);
-
-		for(unsigned long i = 0; i < _storage[index].size(); ++i)
+		_iBloomErased = 0;
+		_bloom.reset(_iCapacity);
+		for(int i = 0; i < _iCapacity; ++i)
 		{
-			if(_storage[index][i].first == key)
+			for(const Entry &entry: _storage[i])
 			{
-				_storage[index].erase(_storage[index].begin() + i);
-				_iSize--;
+				_bloom.add(entry.hash(_hasher));
+			}
+		}
 
-				double ratio = (double) _iSize / _iCapacity;
-				if(ratio < _dLower)
-				{
-					resize(LOWER_FACTOR);
-				}
+		if(_oldStorage == nullptr)
+		{
+			_oldBloom.release();
+			return;
+		}
 
-				return true;
+		_oldBloom.reset(_iOldCapacity);
+		for(int i = _iMigrated; i < _iOldCapacity; ++i)
+		{
+			for(const Entry &entry: _oldStorage[i])
+			{
+				_oldBloom.add(entry.hash(_hasher));
 			}
 		}
-
-		return false;
 	}
 
 	/**
-	 * Get size of vector that contains key
-	 * @param key key to look up
-	 * @return
+	 * Allocate and construct an array of empty buckets
+	 * @param amount amount of buckets
+	 * @return the array, nullptr if amount is 0
 	 */
-	int bucketSize(KeyT key)
+	Bucket* _newBuckets(int amount)
 	{
-		std::hash<KeyT> keyHash;
-		size_t index = keyHash(key) & (_iCapacity - 1);
+		if(amount == 0)
+		{
+			return nullptr;
+		}
+
+		Bucket *buckets = BucketTraits::allocate(_alloc, amount);
+		for(int i = 0; i < amount; ++i)
+		{
+			BucketTraits::construct(_alloc, buckets + i, EntryAlloc(_alloc));
+		}
 
-		return _storage[index].size();
+		return buckets;
 	}
 
 	/**
-	 * Erase all pairs from map
+	 * Destroy and free an array of buckets made by _newBuckets()
+	 * @param buckets the array, may be nullptr
+	 * @param amount amount of buckets in it
 	 */
-	void clear()
+	void _deleteBuckets(Bucket *buckets, int amount)
 	{
-		for(int vIdx = 0; vIdx < _iCapacity; ++vIdx)
+		if(buckets == nullptr)
 		{
-			_storage[vIdx].clear();
+			return;
 		}
 
-		_iSize = DEF_SIZE;
+		if(!DROP_STORAGE)
+		{
+			for(int i = 0; i < amount; ++i)
+			{
+				BucketTraits::destroy(_alloc, buckets + i);
+			}
+		}
+
+		BucketTraits::deallocate(_alloc, buckets, amount);
 	}
-	
+
 	/**
-	 * Overload for = operator
-	 * @param other HashMap to copy
-	 * @return reference to HashMap
+	 * Leave the map empty and without storage, used after moving from it
 	 */
-	HashMap<KeyT, ValueT>& operator=(const HashMap<KeyT, ValueT> &other)
+	void _release()
 	{
-		_dLower = other._dLower;
-		_dUpper = other._dUpper;
-		_iSize = other._iSize;
-		_iCapacity = other._iCapacity;
-		_storage = other._storage;
-		return *this;
+		_iSize = DEF_SIZE;
+		_iCapacity = 0;
+		_storage = nullptr;
+		_iOldCapacity = 0;
+		_iMigrated = 0;
+		_oldStorage = nullptr;
+		_iBloomErased = 0;
+		_bloom.release();
+		_oldBloom.release();
 	}
 
 	/**
-	 * Overload for [] operator, returns value corresponding to given key
-	 * @param key key to look up
-	 * @return value attached to key
+	 * Replace the storage with one of newSize buckets and move every pair
+	 * over, or in incremental mode only start moving them
+	 * @param newSize new capacity, a power of two
 	 */
-	const ValueT& operator[](const KeyT &key) const
+	void _rehashTo(int newSize)
 	{
-		std::hash<KeyT> keyHasher;
-		size_t newIdx = keyHasher(key) & (_iCapacity - 1);
-		for(unsigned long idx = 0; idx < _storage[newIdx].size(); ++idx)
+#ifdef HASHMAP_STATS
+		auto start = std::chrono::steady_clock::now();
+		(newSize > _iCapacity ? _stats.grows : _stats.shrinks)++;
+#endif
+
+		/* A rehash still in progress has to complete before another begins.
+		 * Growth and shrinking never get here mid rehash, see _migrationStep() */
+		_finishRehash();
+
+		Bucket *oldArr = _storage;
+		int oldCap = _iCapacity;
+
+		_storage = _newBuckets(newSize);
+		_iCapacity = newSize;
+
+		/* Migrated pairs are added to the new filter as they move */
+		if(_bBloom)
+		{
+			_oldBloom = std::move(_bloom);
+			_bloom.reset(newSize);
+			_iBloomErased = 0;
+		}
+
+		if(_bIncremental && _iSize > 0)
+		{
+			_oldStorage = oldArr;
+			_iOldCapacity = oldCap;
+			_iMigrated = 0;
+			_iMigrateStep = _migrationStep();
+		}
+		else
 		{
-			if(_storage[newIdx][idx].first == key)
+			/* Move over all items */
+			for(int i = 0; i < oldCap; ++i)
 			{
-				return _storage[newIdx][idx].second;
+				_migrateBucket(oldArr[i]);
 			}
+
+			_deleteBuckets(oldArr, oldCap);
+			_oldBloom.release();
 		}
+
+#ifdef HASHMAP_STATS
+		_stats.resizeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#endif
 	}
 
 	/**
-	 * Overload for [] operator, creates new pair
-	 * @param key key to assign
-	 * @return reference to value
+	 * Construct a pair whose key is known to be absent at the end of its
+	 * bucket, growing the storage first if needed
+	 * @param hash hash of the key
+	 * @param args arguments forwarded to the constructor of value_type
+	 * @return pointer to the new entry
 	 */
-	ValueT& operator[](const KeyT &key)
+	template <class... Args>
+	Entry* _emplaceNew(size_t hash, Args&&... args)
 	{
-		/* Instantiate a pair with the given key */
-		insert(key, 0);
-		int vecIdx = 0;
+		_migrateStep();
 
-		/* Look up the pair and return its second value */
-		std::hash<KeyT> keyHasher;
-		size_t newIdx = keyHasher(key) & (_iCapacity - 1);
-		for(unsigned long idx = 0; idx < _storage[newIdx].size(); ++idx)
+		if(_iCapacity == 0)
 		{
-			if(_storage[newIdx][idx].first == key)
-			{
-				vecIdx = (int) idx;
-			}
+			_rehashTo(_policy.fitCapacity(1));
 		}
-		
-		return _storage[newIdx][vecIdx].second;
+		else if(_policy.shouldGrow(_iSize, _iCapacity))
+		{
+			resize(UPPER_FACTOR);
+		}
+
+		return _emplaceReserved(hash, std::forward<Args>(args)...);
 	}
 
 	/**
-	 * Overload for == operator, checks that all fields are equal
-	 * @param other HashMap to compare to
-	 * @return true if all fields are equal, otherwise false
+	 * Construct a pair whose key is known to be absent at the end of its
+	 * bucket, without checking the load factor
+	 * @param hash hash of the key
+	 * @param args arguments forwarded to the constructor of value_type
+	 * @return pointer to the new entry
 	 */
-	bool operator==(const HashMap<KeyT, ValueT> &other) const
+	template <class... Args>
+	Entry* _emplaceReserved(size_t hash, Args&&... args)
 	{
-		if(_iSize != other._iSize ||
-		   _iCapacity != other._iCapacity ||
-		   _dUpper != other._dUpper ||
-		   _dLower != other._dLower)
+		Bucket &bucket = _storage[hash & (_iCapacity - 1)];
+		bucket.emplace_back(hash, std::forward<Args>(args)...);
+		_iSize++;
+		if(_bBloom)
 		{
-			return false;
+			_bloom.add(hash);
 		}
 
-		for(auto item: other)
-		{
-			if(!this -> containsKey(item.first))
-			{
-				return false;
-			}
+		return &bucket.back();
+	}
 
-			if(item.second != this -> at(item.first))
+	/**
+	 * Merge a pair into a bucket that reserve() already sized for it. Touches
+	 * only that bucket, so threads may merge into different buckets at once
+	 * @param bucket bucket the key hashes to
+	 * @param hash hash of the key, only read when hashes are cached
+	 * @param key key of the pair
+	 * @param value value of the pair
+	 * @param combine called with the current value and value if key is present
+	 * @return 1 if the pair was added, 0 if it was combined into an existing one
+	 */
+	template <class Combine>
+	int _combineInto(Bucket &bucket, size_t hash, const KeyT &key, const ValueT &value, Combine &combine)
+	{
+		for(Entry &entry: bucket)
+		{
+			if(entry.hashMatches(hash) && _keyEqual(entry.item.first, key))
 			{
-				return false;
+				_countLookup(true);
+				entry.item.second = combine(entry.item.second, value);
+				return 0;
 			}
 		}
 
-		return true;
+		_countLookup(false);
+		bucket.emplace_back(hash, key, value);
+		return 1;
 	}
 
 	/**
-	 * Overload for != operator
-	 * @param other HashMap to compare to
-	 * @return opposite of ==
+	 * Get the amount of parts a parallel build splits the storage into, the
+	 * largest power of two not above threads nor the capacity
+	 * @param threads amount of threads asked for
+	 * @return
 	 */
-	bool operator!=(const HashMap<KeyT, ValueT> &other) const
+	int _partitions(int threads) const
 	{
-		return  !(operator==(other));
+		int parts = 1;
+		while(parts * 2 <= threads && parts * 2 <= _iCapacity)
+		{
+			parts *= 2;
+		}
+
+		return parts;
 	}
 
 	/**
-	 * Nested Iterator class
+	 * Call fn(part) for every part on a thread of its own, the calling thread
+	 * takes part 0 and any part no thread could be started for. Returns once
+	 * all parts are done, rethrowing the exception of the lowest part that
+	 * threw, if any
+	 * @param parts amount of parts
+	 * @param fn callable taking the number of a part
 	 */
-	class const_iterator
+	template <class F>
+	static void _runParallel(int parts, F fn)
 	{
-	public:
-		/**
-		 * Constructor that accepts the actual storage of the map over which it iterates
-		 * @param map pointer to storage
-		 * @param mapCap capacity of given map
-		 * @param curVec
-		 */
-		explicit const_iterator(vector<pair<KeyT, ValueT>> *map, int mapCap, int curVec = 0)
+		/* An exception escaping a thread calls std::terminate, so each part keeps its own */
+		vector<std::exception_ptr> errors(parts);
+		auto run = [&fn, &errors](int part)
 		{
-			_map = map;
-			_curVec = curVec;
-			_mapCap = mapCap;
-
-			if(_map != nullptr)
+			try
 			{
-				_mapIt = _map[_curVec].begin();
-
-				/* Find first item in storage, guaranteed to be first item in the vector */
-				while(_mapIt == _map[_curVec].end() && _curVec < _mapCap)
-				{
-					++_curVec;
-					_mapIt = _map[_curVec].begin();
-				}
-
-				/* Reached the end without finding an element */
-				if(_curVec == _mapCap)
-				{
-					_map = nullptr;
-				}
+				fn(part);
 			}
-			else
+			catch(...)
 			{
-				_curVec = _mapCap;
+				errors[part] = std::current_exception();
 			}
-		}
+		};
 
-		/**
-		 * Postfix ncrement operator that holds the logic of iterating over the elements in the map
-		 * @return next element in iteration
-		 */
-		const_iterator& operator++()
+		vector<std::thread> workers;
+		workers.reserve(parts);
+		for(int part = 1; part < parts; ++part)
 		{
-			/* IF we've reached the last element then the next will be end() */
-			if(_curVec + 1 == _mapCap)
+			try
 			{
-				_curVec++;
-				_map = nullptr;
-				return *this;
+				workers.emplace_back(run, part);
 			}
-			
-			/* Use iterator of vector to increment */
-			++_mapIt;
-
-			/* If the increment above reached the end of the vecto */
-			if(_mapIt == _map[_curVec].end())
+			catch(const std::system_error &)
 			{
-				/* Go from vector to vector until you find a pair */
-				while(_mapIt == _map[_curVec].end() && (_curVec + 1 != _mapCap))
-				{
-					++_curVec;
-					_mapIt = _map[_curVec].begin();
-				}
+				run(part);
 			}
-
-			return *this;
-		}
-
-		/**
-		 * Prefix ncrement operator that holds the logic of iterating over the elements in the map
-		 * @return next element in iteration
-		 */
-		const const_iterator operator++(int)
-		{
-			const_iterator temp = *this;
-			operator++();
-			return temp;
 		}
 
-		/**
-		 * Overload for dereference * operator
-		 * @return the item in the map to which the iterator points
-		 */
-		pair<KeyT, ValueT> operator*() const
+		run(0);
+		for(std::thread &worker: workers)
 		{
-			return *_mapIt;
+			worker.join();
 		}
 
-		/**
-		 * Overload for -> opoerator.
-		 * @return
-		 */
-		pair<KeyT, ValueT>* operator->() const
+		for(const std::exception_ptr &error: errors)
 		{
-			return *_mapIt;
+			if(error)
+			{
+				std::rethrow_exception(error);
+			}
 		}
+	}
 
-		/**
-		 * Overload for == operator
-		 * @param other iterator to compare to
-		 * @return true if operators point to the same location, otherwise false
-		 */
-		bool operator==(const const_iterator &other) const
+	/**
+	 * Insert a pair into storage that reserve() already sized for it
+	 * @param key key of the pair
+	 * @param value value of the pair
+	 */
+	template <class K, class V>
+	void _insertReserved(K &&key, V &&value)
+	{
+		size_t hash = _hash(key);
+		if(_locate(key, hash) == nullptr)
 		{
-			/* For comparison with end() */
-			if(this -> _curVec == this -> _mapCap)
-			{
-				return true;
-			}
-			return _mapIt == other._mapIt;
+			_emplaceReserved(hash, std::forward<K>(key), std::forward<V>(value));
 		}
+	}
 
-		/**
-		 * Overload for != operator
-		 * @param other iterator to compare to
-		 * @return opposite of ==
-		 */
-		bool operator!=(const const_iterator &other) const
+	/**
+	 * Shared implementation of try_emplace()
+	 * @param key key to look up, forwarded into the map if inserted
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and whether it was inserted
+	 */
+	template <class K, class... Args>
+	pair<ValueT*, bool> _tryEmplace(K &&key, Args&&... args)
+	{
+		size_t hash = _hash(key);
+		Entry *entry = _locate(key, hash);
+		if(entry != nullptr)
 		{
-			return !(*this == other);
+			return pair<ValueT*, bool>(&entry -> item.second, false);
 		}
 
-	private:
-		typename vector<pair<KeyT, ValueT>>::iterator _mapIt;
-		vector<pair<KeyT, ValueT>> *_map;
-		int _curVec;
-		int _mapCap;
-	};
+		entry = _emplaceNew(hash, std::piecewise_construct,
+		                    std::forward_as_tuple(std::forward<K>(key)),
+		                    std::forward_as_tuple(std::forward<Args>(args)...));
+		return pair<ValueT*, bool>(&entry -> item.second, true);
+	}
 
 	/**
-	 * Returns first element in iteration
-	 * @return
+	 * Shared implementation of find()
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
 	 */
-	const_iterator begin() const
+	template <class K>
+	ValueT* _findValue(const K &key) const
 	{
-		return const_iterator(this -> _storage, this -> capacity());
+		Entry *entry = _locate(key, _hash(key));
+		return entry == nullptr ? nullptr : &entry -> item.second;
 	}
 
 	/**
-	 * Returns the element "one after the last"
-	 * @return
+	 * Shared implementation of at()
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
 	 */
-	const_iterator end() const
+	template <class K>
+	ValueT _at(const K &key) const
 	{
-		return const_iterator(nullptr, this -> capacity(), this -> capacity());
+		const ValueT *value = _findValue(key);
+		if(value == nullptr)
+		{
+			throw invalidKeyException("Key not present in map");
+		}
+
+		return *value;
 	}
-	
+
 	/**
-	 * Returns first element in iteration
-	 * @return
+	 * Shared implementation of erase()
+	 * @param key key to look up
+	 * @return true if value successfully erased, otherwise false
 	 */
-	const_iterator cbegin()
+	template <class K>
+	bool _erase(const K &key)
 	{
-		return const_iterator(this -> _storage, this -> capacity());
+		if(_iSize == 0)
+		{
+			_countLookup(false);
+			return false;
+		}
+
+		size_t hash = _hash(key);
+		_migrateStep();
+
+		if(!_eraseFromBucket(_storage[hash & (_iCapacity - 1)], key, hash) &&
+		   (_oldStorage == nullptr || !_eraseFromBucket(_oldStorage[hash & (_iOldCapacity - 1)], key, hash)))
+		{
+			_countLookup(false);
+			return false;
+		}
+
+		_countLookup(true);
+
+		_iSize--;
+
+		if(_policy.shouldShrink(_iSize, _iCapacity))
+		{
+			resize(LOWER_FACTOR);
+		}
+		else if(_bBloom && ++_iBloomErased > _iCapacity / 2)
+		{
+			_rebuildBloom();
+		}
+
+		return true;
 	}
-	
+
 	/**
-	 * Returns the element "one after the last"
-	 * @return
+	 * Erase the entry holding key from a single bucket
+	 * @param bucket bucket to scan
+	 * @param key key to look up
+	 * @param hash hash of key
+	 * @return true if key was found and erased, otherwise false
 	 */
-	const_iterator cend()
+	template <class K>
+	bool _eraseFromBucket(Bucket &bucket, const K &key, size_t hash) const
 	{
-		return const_iterator(nullptr, this -> capacity(), this -> capacity());
+		for(unsigned long i = 0; i < bucket.size(); ++i)
+		{
+			if(bucket[i].hashMatches(hash) && _keyEqual(bucket[i].item.first, key))
+			{
+				bucket.erase(bucket.begin() + i);
+				return true;
+			}
+		}
+
+		return false;
 	}
 
-private:
-	double _dLower;
-	double _dUpper;
+	BucketAlloc _alloc;
+	Hash _hasher;
+	KeyEqual _keyEqual;
+	GrowthPolicy _policy;
 	int _iSize;
 	int _iCapacity;
-	vector<pair<KeyT, ValueT>> *_storage;
+	Bucket *_storage;
+	bool _bIncremental;
+	int _iOldCapacity;
+	int _iMigrated;
+	int _iMigrateStep;
+	Bucket *_oldStorage;
+	bool _bBloom;
+	int _iBloomErased;
+	BloomFilter _bloom;
+	BloomFilter _oldBloom;
+
+#ifdef HASHMAP_STATS
+	/**
+	 * Counters behind stats(). Lookups are const and may run concurrently
+	 * (see ConcurrentHashMap), so their counters are relaxed atomics. A copy
+	 * of a map starts counting from zero, while a move hands the counters
+	 * over with the table and leaves the moved from map at zero
+	 */
+	struct StatCounters
+	{
+		StatCounters() {}
+
+		StatCounters(const StatCounters &) {}
+
+		StatCounters(StatCounters &&other) noexcept
+		{
+			*this = std::move(other);
+		}
+
+		StatCounters& operator=(const StatCounters &)
+		{
+			hits = 0;
+			misses = 0;
+			grows = 0;
+			shrinks = 0;
+			resizeSeconds = 0;
+			return *this;
+		}
+
+		StatCounters& operator=(StatCounters &&other) noexcept
+		{
+			hits = other.hits.exchange(0, std::memory_order_relaxed);
+			misses = other.misses.exchange(0, std::memory_order_relaxed);
+			grows = std::exchange(other.grows, 0);
+			shrinks = std::exchange(other.shrinks, 0);
+			resizeSeconds = std::exchange(other.resizeSeconds, 0);
+			return *this;
+		}
+
+		mutable std::atomic<long> hits{0};
+		mutable std::atomic<long> misses{0};
+		long grows = 0;
+		long shrinks = 0;
+		double resizeSeconds = 0;
+	};
+
+	StatCounters _stats;
+#endif
 };
 
+/**
+ * HashMap whose buckets and entries are allocated from a MonotonicArena
+ * (see MonotonicArena.hpp), construct it with the arena. For trivially
+ * destructible keys and values clear() and destruction are O(1)
+ */
+template <class KeyT, class ValueT, class Hash = KeyHash<KeyT>, class KeyEqual = std::equal_to<>>
+using ArenaHashMap = HashMap<KeyT, ValueT, Hash, KeyEqual, false, ArenaAllocator<pair<KeyT, ValueT>>>;
+
 #endif //CPP_EX3_HASHMAP_HPP
\ No newline at end of file
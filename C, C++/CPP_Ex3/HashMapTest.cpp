@@ -0,0 +1,982 @@
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "HashMap.hpp"
+#include "FlatHashMap.hpp"
+#include "ConcurrentHashMap.hpp"
+#include "PerfectHashMap.hpp"
+#include "DenseHashMap.hpp"
+#include "VersionedHashMap.hpp"
+#include "IntHashMap.hpp"
+
+#define TEST_SEED 2020
+#define RANDOM_OPS 200000
+#define RANDOM_KEYS 2000
+#define CHURN_OPS 100000
+#define CHURN_LIVE 8
+#define CHURN_MAX_CAPACITY 64
+#define GROWTH_KEYS 20000
+#define GROWTH_KEPT 10
+#define WALK_STEPS 50
+#define WALK_LENGTH 200
+#define WRITER_THREADS 4
+#define THREAD_KEYS 4096
+#define SHARED_COUNTERS 16
+#define MERGE_MAPS 3
+#define MERGE_THREADS 4
+#define MERGE_SEED 7
+#define BLOOM_CAPACITY 4096
+#define BLOOM_MAX_FALSE_POSITIVES 0.05
+#define PUBLISHED_VERSIONS 200
+#define VERSION_KEYS 256
+
+using std::string;
+
+/**
+ * Value whose constructor from a negative int throws, for exception safety
+ */
+struct ThrowingValue
+{
+	ThrowingValue(): value(0) {}
+
+	explicit ThrowingValue(int value): value(value)
+	{
+		if(value < 0)
+		{
+			throw std::runtime_error("Negative value");
+		}
+	}
+
+	int value;
+};
+
+typedef std::unordered_map<int, int> Reference;
+
+int failures = 0;
+
+/**
+ * Report a failed check
+ * @param passed result of the check
+ * @param what description of the check
+ */
+void check(bool passed, const string &what)
+{
+	if(!passed)
+	{
+		std::cerr << "FAILED: " << what << "\n";
+		failures++;
+	}
+}
+
+/**
+ * Check that a map holds exactly the pairs of a reference map, through
+ * lookups and through iteration
+ * @tparam Map map with int keys and values
+ * @param map map to check
+ * @param reference expected pairs
+ * @param label name of the map in failure reports
+ */
+template <class Map>
+void checkSame(const Map &map, const Reference &reference, const string &label)
+{
+	check(map.size() == (int) reference.size(), label + " size");
+	for(const auto &item: reference)
+	{
+		const int *value = map.find(item.first);
+		if(value == nullptr || *value != item.second)
+		{
+			check(false, label + " value of " + std::to_string(item.first));
+			return;
+		}
+	}
+
+	std::unordered_set<int> seen;
+	for(const auto &item: map)
+	{
+		auto expected = reference.find(item.first);
+		if(expected == reference.end() || expected -> second != item.second || !seen.insert(item.first).second)
+		{
+			check(false, label + " iteration at " + std::to_string(item.first));
+			return;
+		}
+	}
+
+	check(seen.size() == reference.size(), label + " iteration covers every pair");
+}
+
+/**
+ * FlatHashMap against std::unordered_map: random inserts, assignments and
+ * erasures over a small key range, so slots are deleted and reused often
+ */
+void testFlatRandom()
+{
+	FlatHashMap<int, int> map;
+	Reference reference;
+	std::mt19937 random(TEST_SEED);
+	for(int op = 0; op < RANDOM_OPS; ++op)
+	{
+		int key = (int) (random() % RANDOM_KEYS);
+		int value = (int) (random() % 1000);
+		switch(random() % 3)
+		{
+			case 0:
+				check(map.insert(key, value) == reference.emplace(key, value).second, "flat insert result");
+				break;
+			case 1:
+				check(map.insert_or_assign(key, value) == (reference.count(key) == 0), "flat assign result");
+				reference[key] = value;
+				break;
+			default:
+				check(map.erase(key) == (reference.erase(key) == 1), "flat erase result");
+				break;
+		}
+	}
+
+	checkSame(map, reference, "flat random");
+}
+
+/**
+ * Inserting and erasing a fresh key at a time must reuse deleted slots
+ * instead of growing the table
+ */
+void testFlatTombstones()
+{
+	FlatHashMap<int, int> map;
+	Reference reference;
+	for(int key = 0; key < CHURN_LIVE; ++key)
+	{
+		map.insert(key, key);
+		reference[key] = key;
+	}
+
+	int maxCapacity = map.capacity();
+	for(int key = CHURN_LIVE; key < CHURN_LIVE + CHURN_OPS; ++key)
+	{
+		map.insert(key, key);
+		map.erase(key);
+		maxCapacity = std::max(maxCapacity, map.capacity());
+	}
+
+	check(maxCapacity <= CHURN_MAX_CAPACITY, "flat capacity bounded under churn");
+	checkSame(map, reference, "flat churn");
+}
+
+/**
+ * The table grows while filled and shrinks back when emptied, keeping
+ * every pair through each rehash
+ */
+void testFlatGrowth()
+{
+	FlatHashMap<int, int> map;
+	Reference reference;
+	int initial = map.capacity();
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		map.insert(key, -key);
+		reference[key] = -key;
+	}
+
+	int grown = map.capacity();
+	check(grown > initial && map.getLoadFactor() <= FLAT_MAX_LOAD, "flat grows within max load");
+	checkSame(map, reference, "flat grown");
+
+	for(int key = GROWTH_KEPT; key < GROWTH_KEYS; ++key)
+	{
+		map.erase(key);
+		reference.erase(key);
+	}
+
+	check(map.capacity() < grown, "flat shrinks");
+	checkSame(map, reference, "flat shrunk");
+
+	FlatHashMap<int, int> copy(map);
+	check(copy == map, "flat copy equal");
+	copy.erase(0);
+	check(copy != map, "flat copy independent");
+}
+
+/**
+ * String keys, looked up by std::string_view without building a string
+ */
+void testFlatStrings()
+{
+	FlatHashMap<string, int> map;
+	for(int i = 0; i < GROWTH_KEYS; ++i)
+	{
+		map.insert("key" + std::to_string(i), i);
+	}
+
+	bool found = true;
+	for(int i = 0; i < GROWTH_KEYS; ++i)
+	{
+		string key = "key" + std::to_string(i);
+		const int *value = map.find(std::string_view(key));
+		found = found && value != nullptr && *value == i;
+	}
+
+	check(found, "flat string_view lookups");
+	check(!map.containsKey(std::string_view("key")), "flat string_view miss");
+	check(map.erase(std::string_view("key7")) && !map.containsKey("key7"), "flat string_view erase");
+}
+
+/**
+ * IntHashMap against std::unordered_map. Erasing shifts the rest of a probe
+ * run back, so every erasure must leave the keys after it reachable
+ */
+void testIntRandom()
+{
+	IntHashMap<int, int> map;
+	Reference reference;
+	std::mt19937 random(TEST_SEED);
+	for(int op = 0; op < RANDOM_OPS; ++op)
+	{
+		int key = (int) (random() % RANDOM_KEYS);
+		if(random() % 2 == 0)
+		{
+			map.insert_or_assign(key, op);
+			reference[key] = op;
+		}
+		else
+		{
+			check(map.erase(key) == (reference.erase(key) == 1), "int erase result");
+		}
+	}
+
+	checkSame(map, reference, "int random");
+}
+
+/**
+ * EmptyKey marks empty slots, so it can't be inserted, while its neighbours
+ * and a custom EmptyKey's neighbours can
+ */
+void testIntSentinel()
+{
+	IntHashMap<int, int> map;
+	try
+	{
+		map.insert(std::numeric_limits<int>::max(), 1);
+		check(false, "int EmptyKey rejected");
+	}
+	catch(const invalidKeyException &)
+	{
+	}
+
+	check(map.empty() && !map.containsKey(std::numeric_limits<int>::max()), "int EmptyKey not stored");
+	check(map.insert(std::numeric_limits<int>::max() - 1, 2) && map.at(std::numeric_limits<int>::max() - 1) == 2,
+	      "int key next to EmptyKey stored");
+
+	IntHashMap<int, int, 0> zeroEmpty;
+	check(zeroEmpty.insert(std::numeric_limits<int>::max(), 3) && zeroEmpty.insert(-1, 4), "custom EmptyKey");
+	try
+	{
+		zeroEmpty.insert(0, 5);
+		check(false, "custom EmptyKey rejected");
+	}
+	catch(const invalidKeyException &)
+	{
+	}
+
+	check(zeroEmpty.size() == 2, "custom EmptyKey map size");
+}
+
+/**
+ * The table grows while filled and shrinks back when emptied, and a value
+ * constructor that throws leaves the map as it was
+ */
+void testIntGrowth()
+{
+	IntHashMap<int, int> map;
+	Reference reference;
+	int initial = map.capacity();
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		map.insert(key * 7, key);
+		reference[key * 7] = key;
+	}
+
+	int grown = map.capacity();
+	check(grown > initial && map.getLoadFactor() <= INT_MAX_LOAD, "int grows within max load");
+	checkSame(map, reference, "int grown");
+
+	for(int key = GROWTH_KEPT; key < GROWTH_KEYS; ++key)
+	{
+		map.erase(key * 7);
+		reference.erase(key * 7);
+	}
+
+	check(map.capacity() < grown, "int shrinks");
+	checkSame(map, reference, "int shrunk");
+
+	IntHashMap<int, ThrowingValue> values;
+	values.try_emplace(1, 1);
+	try
+	{
+		values.try_emplace(2, -1);
+		check(false, "int throwing value propagates");
+	}
+	catch(const std::runtime_error &)
+	{
+	}
+
+	check(values.size() == 1 && !values.containsKey(2) && values.find(1) -> value == 1,
+	      "int throwing value leaves map unchanged");
+}
+
+/**
+ * Lookups, erasures and iteration while an incremental rehash is in progress
+ * see the pairs of both storages exactly once
+ */
+void testRehashMidway()
+{
+	HashMap<int, int> map;
+	map.setIncrementalRehash(true);
+	Reference reference;
+	int key = 0;
+	while(!map.isRehashing())
+	{
+		map.insert(key, -key);
+		reference[key] = -key;
+		key++;
+	}
+
+	checkSame(map, reference, "rehash started");
+
+	map.erase(0);
+	reference.erase(0);
+	map.insert(key, -key);
+	reference[key] = -key;
+	check(map.isRehashing(), "rehash still in progress");
+	checkSame(map, reference, "rehash in progress");
+
+	std::mt19937 random(TEST_SEED);
+	for(int op = 0; op < RANDOM_OPS; ++op)
+	{
+		int k = (int) (random() % RANDOM_KEYS);
+		if(random() % 2 == 0)
+		{
+			map.insert_or_assign(k, op);
+			reference[k] = op;
+		}
+		else
+		{
+			check(map.erase(k) == (reference.erase(k) == 1), "rehash erase result");
+		}
+	}
+
+	checkSame(map, reference, "rehash random");
+}
+
+/**
+ * Random walks of inserts and erases started right after a grow: the policy
+ * must never resize the map while the old storage still holds buckets,
+ * since finishing the rehash there would cost a whole map rehash
+ * @param policy growth policy of the walked map
+ * @param label name of the policy in failure reports
+ */
+void testRehashBound(const GrowthPolicy &policy, const string &label)
+{
+	std::mt19937 random(TEST_SEED);
+	for(int walk = 0; walk < WALK_STEPS; ++walk)
+	{
+		HashMap<int, int> map(policy);
+		map.setIncrementalRehash(true);
+		int next = 0;
+		while(!map.isRehashing())
+		{
+			map.insert(next, next);
+			next++;
+		}
+
+		/* Walks lean to erasures in odd rounds and to inserts in even ones */
+		bool drained = false;
+		for(int op = 0; op < WALK_LENGTH && !drained; ++op)
+		{
+			bool wasRehashing = map.isRehashing();
+			int capacity = map.capacity();
+			if((int) (random() % 4) < (walk % 2 == 0 ? 1 : 3) && map.size() > 0)
+			{
+				map.erase(next - 1 - (int) (random() % map.size()));
+			}
+			else
+			{
+				map.insert(next, next);
+				next++;
+			}
+
+			drained = wasRehashing && map.capacity() != capacity;
+		}
+
+		check(!drained, label + " resize waits for the rehash");
+	}
+}
+
+/**
+ * Writers insert disjoint keys and bump shared counters while a reader looks
+ * the keys up: the reader never sees a wrong value and nothing is lost
+ */
+void testConcurrent()
+{
+	ConcurrentHashMap<int, int> map;
+	std::atomic<bool> writing(true);
+	std::atomic<int> wrongReads(0);
+
+	std::thread reader([&]()
+	{
+		while(writing)
+		{
+			for(int key = 0; key < WRITER_THREADS * THREAD_KEYS; key += 7)
+			{
+				int value = 0;
+				if(map.get(key, value) && value != key)
+				{
+					wrongReads++;
+				}
+			}
+		}
+	});
+
+	vector<std::thread> writers;
+	for(int thread = 0; thread < WRITER_THREADS; ++thread)
+	{
+		writers.emplace_back([&map, thread]()
+		{
+			for(int i = 0; i < THREAD_KEYS; ++i)
+			{
+				int key = thread * THREAD_KEYS + i;
+				map.insert(key, key);
+				map.fetch_add(-1 - i % SHARED_COUNTERS, 1);
+			}
+		});
+	}
+
+	for(std::thread &writer: writers)
+	{
+		writer.join();
+	}
+
+	writing = false;
+	reader.join();
+
+	check(wrongReads == 0, "concurrent reads see inserted values");
+	check(map.size() == WRITER_THREADS * THREAD_KEYS + SHARED_COUNTERS, "concurrent size");
+
+	bool found = true;
+	for(int key = 0; key < WRITER_THREADS * THREAD_KEYS; ++key)
+	{
+		int value = 0;
+		found = found && map.get(key, value) && value == key;
+	}
+
+	check(found, "concurrent inserts kept");
+	for(int counter = 1; counter <= SHARED_COUNTERS; ++counter)
+	{
+		check(map.at(-counter) == WRITER_THREADS * THREAD_KEYS / SHARED_COUNTERS,
+		      "concurrent counter " + std::to_string(counter));
+	}
+}
+
+/**
+ * Every key a PerfectHashMap is built from is found with its value, and
+ * keys it wasn't built from are rejected
+ */
+void testPerfect()
+{
+	HashMap<int, int> source;
+	Reference reference;
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		source.insert(key * 3, key);
+		reference[key * 3] = key;
+	}
+
+	PerfectHashMap<int, int> map(source);
+	checkSame(map, reference, "perfect");
+
+	bool rejected = true;
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		rejected = rejected && !map.containsKey(key * 3 + 1) && map.find(key * 3 + 2) == nullptr;
+	}
+
+	check(rejected && !map.containsKey(-1), "perfect rejects absent keys");
+	try
+	{
+		map.at(1);
+		check(false, "perfect at() of an absent key throws");
+	}
+	catch(const invalidKeyException &)
+	{
+	}
+
+	vector<pair<string, int>> words = {{"spam", 1}, {"ham", 2}, {"spam", 3}};
+	PerfectHashMap<string, int> strings(words.begin(), words.end());
+	check(strings.size() == 2 && strings.at("spam") == 1, "perfect first repeated key wins");
+	check(strings.find(std::string_view("ham")) != nullptr && !strings.containsKey(std::string_view("eggs")),
+	      "perfect string_view lookups");
+
+	vector<pair<int, int>> none;
+	PerfectHashMap<int, int> empty(none.begin(), none.end());
+	check(empty.empty() && !empty.containsKey(0), "perfect empty map");
+}
+
+/**
+ * DenseHashMap against std::unordered_map. Erasing moves the last pair into
+ * the hole it leaves, so the moved pair must stay reachable and reinserted
+ * keys must not find stale index slots
+ */
+void testDense()
+{
+	DenseHashMap<int, int> map;
+	Reference reference;
+	std::mt19937 random(TEST_SEED);
+	for(int op = 0; op < RANDOM_OPS; ++op)
+	{
+		int key = (int) (random() % RANDOM_KEYS);
+		switch(random() % 3)
+		{
+			case 0:
+				check(map.insert(key, op) == reference.emplace(key, op).second, "dense insert result");
+				break;
+			case 1:
+				check(map.insert_or_assign(key, op) == (reference.count(key) == 0), "dense assign result");
+				reference[key] = op;
+				break;
+			default:
+				check(map.erase(key) == (reference.erase(key) == 1), "dense erase result");
+				break;
+		}
+	}
+
+	checkSame(map, reference, "dense random");
+
+	/* Erase every pair and insert it again in reverse order */
+	DenseHashMap<int, int> reinserted(map);
+	for(const auto &item: reference)
+	{
+		reinserted.erase(item.first);
+	}
+
+	check(reinserted.empty(), "dense erased all");
+	vector<pair<int, int>> items(reference.begin(), reference.end());
+	for(auto it = items.rbegin(); it != items.rend(); ++it)
+	{
+		reinserted.insert(it -> first, it -> second);
+	}
+
+	checkSame(reinserted, reference, "dense reinserted");
+	check(reinserted == map, "dense equal after reinsertion");
+	reinserted.erase(items[0].first);
+	check(reinserted != map, "dense differs after erasure");
+}
+
+/**
+ * Merge value of a key present in both maps, not symmetric so the order of
+ * the arguments shows
+ * @param mine value in the map merged into
+ * @param theirs value in the map merged from
+ * @return
+ */
+int mergeValues(int mine, int theirs)
+{
+	return mine * 2 + theirs;
+}
+
+/**
+ * merge() keeps pairs of either map and combines values of shared keys as
+ * combine(this value, other value), both when the capacities match and when
+ * they don't. mergeParallel() and buildParallel() agree with a sequential
+ * merge
+ */
+void testMerge()
+{
+	HashMap<int, int> small;
+	HashMap<int, int> large;
+	Reference expected;
+	for(int key = 0; key < RANDOM_KEYS; ++key)
+	{
+		large.insert(key, key);
+		expected[key] = key;
+	}
+
+	for(int key = RANDOM_KEYS - GROWTH_KEPT; key < RANDOM_KEYS + GROWTH_KEPT; ++key)
+	{
+		small.insert(key, 1);
+		expected[key] = expected.count(key) == 0 ? 1 : mergeValues(expected[key], 1);
+	}
+
+	HashMap<int, int> merged(large);
+	merged.merge(small, mergeValues);
+	checkSame(merged, expected, "merge of a smaller map");
+
+	/* merge() reserves room for both maps, which other already has */
+	HashMap<int, int> sameCapacity(large);
+	sameCapacity.reserve(2 * large.size());
+	merged = large;
+	merged.merge(sameCapacity, mergeValues);
+	bool combined = merged.size() == large.size() && merged.capacity() == sameCapacity.capacity();
+	for(int key = 0; key < RANDOM_KEYS; ++key)
+	{
+		combined = combined && merged.at(key) == key * 3;
+	}
+
+	check(combined, "merge of a map of the same capacity");
+
+	merged = small;
+	merged.merge(merged, mergeValues);
+	check(merged.size() == small.size() && merged.at(RANDOM_KEYS) == 3, "merge into itself");
+
+	/* Shifted key ranges, so keys are shared by one, two or all maps */
+	vector<HashMap<int, int>> maps(MERGE_MAPS);
+	vector<pair<int, int>> pairs;
+	Reference counts;
+	for(int map = 0; map < MERGE_MAPS; ++map)
+	{
+		for(int key = map * RANDOM_KEYS / 2; key < map * RANDOM_KEYS / 2 + RANDOM_KEYS; ++key)
+		{
+			maps[map].insert(key, 1);
+			pairs.emplace_back(key, 1);
+			counts[key]++;
+		}
+	}
+
+	auto add = [](int mine, int theirs)
+	{
+		return mine + theirs;
+	};
+
+	checkSame(HashMap<int, int>::mergeParallel(maps, MERGE_THREADS, add), counts, "mergeParallel");
+	checkSame(HashMap<int, int>::buildParallel(pairs.begin(), pairs.end(), MERGE_THREADS, add), counts,
+	          "buildParallel");
+
+	/* Every key but the last is shared, so only one thread throws */
+	auto throwOnLast = [](int mine, int theirs)
+	{
+		if(mine == RANDOM_KEYS - 1)
+		{
+			throw std::runtime_error("Combine failed");
+		}
+
+		return mine + theirs;
+	};
+
+	vector<pair<int, int>> repeated;
+	for(int key = 0; key < RANDOM_KEYS; ++key)
+	{
+		repeated.emplace_back(key, key);
+		repeated.emplace_back(key, key);
+	}
+
+	bool rethrown = false;
+	try
+	{
+		HashMap<int, int>::mergeParallel(vector<HashMap<int, int>>(2, large), MERGE_THREADS, throwOnLast);
+	}
+	catch(const std::runtime_error &)
+	{
+		rethrown = true;
+	}
+
+	check(rethrown, "mergeParallel rethrows combine exceptions");
+	rethrown = false;
+	try
+	{
+		HashMap<int, int>::buildParallel(repeated.begin(), repeated.end(), MERGE_THREADS, throwOnLast);
+	}
+	catch(const std::runtime_error &)
+	{
+		rethrown = true;
+	}
+
+	check(rethrown, "buildParallel rethrows combine exceptions");
+
+	/* merge() of maps of equal capacity moves buckets without hashing, so
+	 * it only finds the pairs if both maps use the seed given to buildParallel() */
+	vector<pair<string, int>> words;
+	for(int key = 0; key < RANDOM_KEYS; ++key)
+	{
+		words.emplace_back("word" + std::to_string(key), key);
+	}
+
+	KeyHash<string> seeded(MERGE_SEED);
+	HashMap<string, int> built = HashMap<string, int>::buildParallel(words.begin(), words.end(), MERGE_THREADS,
+	                                                                 add, seeded);
+	HashMap<string, int> target(DEF_LOWER, DEF_UPPER, seeded);
+	target.merge(built, add);
+	bool found = target.capacity() == built.capacity() && target.size() == RANDOM_KEYS;
+	for(const auto &word: words)
+	{
+		found = found && target.containsKey(word.first);
+	}
+
+	check(found, "buildParallel uses the given hasher");
+}
+
+/**
+ * A Bloom filter answers true for every hash added to it, and false for most
+ * others. A map filtering its lookups still finds every key it holds,
+ * through inserts, erasures, rebuilds and incremental rehashes
+ */
+void testBloom()
+{
+	BloomFilter filter;
+	filter.reset(BLOOM_CAPACITY);
+	int added = (int) (BLOOM_CAPACITY * DEF_UPPER);
+	for(int hash = 0; hash < added; ++hash)
+	{
+		filter.add(hash);
+	}
+
+	bool noFalseNegatives = true;
+	int falsePositives = 0;
+	for(int hash = 0; hash < added; ++hash)
+	{
+		noFalseNegatives = noFalseNegatives && filter.mayContain(hash);
+		falsePositives += filter.mayContain(hash + added);
+	}
+
+	check(noFalseNegatives, "bloom filter has no false negatives");
+	check(falsePositives < added * BLOOM_MAX_FALSE_POSITIVES, "bloom filter rejects most absent hashes");
+
+	HashMap<int, int> map;
+	map.setBloomFilter(true);
+	map.setIncrementalRehash(true);
+	Reference reference;
+	std::mt19937 random(TEST_SEED);
+	for(int op = 0; op < RANDOM_OPS; ++op)
+	{
+		int key = (int) (random() % RANDOM_KEYS);
+		if(random() % 2 == 0)
+		{
+			map.insert_or_assign(key, op);
+			reference[key] = op;
+			check(map.containsKey(key), "bloom map finds inserted key " + std::to_string(key));
+		}
+		else
+		{
+			map.erase(key);
+			reference.erase(key);
+			check(!map.containsKey(key), "bloom map misses erased key " + std::to_string(key));
+		}
+	}
+
+	checkSame(map, reference, "bloom random");
+
+	HashMap<int, int> unfiltered;
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		unfiltered.insert(key, -key);
+	}
+
+	unfiltered.setBloomFilter(true);
+	bool found = true;
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		found = found && unfiltered.containsKey(key) && !unfiltered.containsKey(-1 - key);
+	}
+
+	check(found, "bloom filter enabled on a full map");
+}
+
+/**
+ * Check that a snapshot holds exactly the pairs of a reference map
+ * @param snapshot snapshot to check
+ * @param reference expected pairs
+ * @param label name of the snapshot in failure reports
+ */
+void checkSnapshot(const VersionedHashMap<int, int>::Snapshot &snapshot, const Reference &reference,
+                   const string &label)
+{
+	check(snapshot.size() == (int) reference.size(), label + " size");
+	bool found = true;
+	for(const auto &item: reference)
+	{
+		const int *value = snapshot.find(item.first);
+		found = found && value != nullptr && *value == item.second;
+	}
+
+	int visited = 0;
+	snapshot.forEach([&](const pair<int, int> &item)
+	{
+		auto expected = reference.find(item.first);
+		found = found && expected != reference.end() && expected -> second == item.second;
+		visited++;
+	});
+
+	check(found && visited == (int) reference.size(), label + " pairs");
+}
+
+/**
+ * A snapshot keeps the version it was taken of through later writes and
+ * publishes, and a reader taking snapshots while a writer publishes never
+ * sees half of a version
+ */
+void testVersioned()
+{
+	VersionedHashMap<int, int> map;
+	Reference first;
+	for(int key = 0; key < RANDOM_KEYS; ++key)
+	{
+		map.insert(key, key);
+		first[key] = key;
+	}
+
+	check(map.snapshot().empty(), "versioned writes unseen before publish");
+	map.publish();
+	VersionedHashMap<int, int>::Snapshot snapshot = map.snapshot();
+	checkSnapshot(snapshot, first, "versioned first");
+
+	Reference second(first);
+	for(int key = 0; key < RANDOM_KEYS; key += 3)
+	{
+		map.erase(key);
+		second.erase(key);
+		map.insert_or_assign(key + 1, -key);
+		second[key + 1] = -key;
+		map.insert(RANDOM_KEYS + key, key);
+		second[RANDOM_KEYS + key] = key;
+	}
+
+	checkSnapshot(snapshot, first, "versioned first after writes");
+	checkSnapshot(map.snapshot(), first, "versioned unpublished writes");
+	map.publish();
+	checkSnapshot(map.snapshot(), second, "versioned second");
+	check(map.snapshot().version() == snapshot.version() + 1, "versioned numbers");
+
+	vector<pair<int, int>> reloaded = {{-1, 1}};
+	map.assign(reloaded.begin(), reloaded.end());
+	map.publish();
+	checkSnapshot(snapshot, first, "versioned first after assign");
+	check(map.snapshot().size() == 1 && map.snapshot().at(-1) == 1, "versioned assign");
+
+	/* Every version binds all keys to its own number */
+	std::atomic<bool> publishing(true);
+	std::atomic<int> tornReads(0);
+	std::thread reader([&]()
+	{
+		while(publishing)
+		{
+			VersionedHashMap<int, int>::Snapshot current = map.snapshot();
+			const int *expected = current.find(0);
+			for(int key = 1; key < VERSION_KEYS && expected != nullptr; ++key)
+			{
+				const int *value = current.find(key);
+				if(value == nullptr || *value != *expected)
+				{
+					tornReads++;
+					break;
+				}
+			}
+		}
+	});
+
+	for(int version = 0; version < PUBLISHED_VERSIONS; ++version)
+	{
+		for(int key = 0; key < VERSION_KEYS; ++key)
+		{
+			map.insert_or_assign(key, version);
+		}
+
+		map.publish();
+	}
+
+	publishing = false;
+	reader.join();
+	check(tornReads == 0, "versioned snapshots never torn");
+}
+
+#ifdef HASHMAP_STATS
+/**
+ * Check the counters stats() reports
+ * @param map map to check
+ * @param grows expected amount of grows
+ * @param hits expected amount of lookup hits
+ * @param label name of the map in failure reports
+ */
+void checkStats(const HashMap<int, int> &map, long grows, long hits, const string &label)
+{
+	HashMapStats stats = map.stats();
+	check(stats.grows == grows && stats.hits == hits, label + " stats");
+}
+
+/**
+ * The counters of stats() move with the table, a copy and the map moved
+ * from start over
+ */
+void testStats()
+{
+	HashMap<int, int> map;
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		map.insert(key, key);
+	}
+
+	for(int key = 0; key < GROWTH_KEYS; ++key)
+	{
+		map.containsKey(key);
+	}
+
+	HashMapStats stats = map.stats();
+	check(stats.grows > 0 && stats.hits == GROWTH_KEYS && stats.misses >= GROWTH_KEYS, "stats counted");
+
+	HashMap<int, int> copy(map);
+	checkStats(copy, 0, 0, "copy");
+
+	HashMap<int, int> moved(std::move(map));
+	checkStats(moved, stats.grows, stats.hits, "move constructed");
+	checkStats(map, 0, 0, "moved from");
+
+	copy = std::move(moved);
+	checkStats(copy, stats.grows, stats.hits, "move assigned");
+	checkStats(moved, 0, 0, "move assigned from");
+
+	moved = copy;
+	checkStats(moved, 0, 0, "copy assigned");
+
+	copy.resetStats();
+	checkStats(copy, 0, 0, "reset");
+}
+#endif
+
+/**
+ * Runs every test, prints failed checks
+ * @return EXIT_SUCCESS if all passed, otherwise EXIT_FAILURE
+ */
+int main()
+{
+	testFlatRandom();
+	testFlatTombstones();
+	testFlatGrowth();
+	testFlatStrings();
+	testIntRandom();
+	testIntSentinel();
+	testIntGrowth();
+	testRehashMidway();
+	testRehashBound(GrowthPolicy(), "default policy");
+	testRehashBound(GrowthPolicy(0.25, 0.5), "low load policy");
+	testRehashBound(GrowthPolicy(0.1, 0.9), "wide policy");
+	testConcurrent();
+	testPerfect();
+	testDense();
+	testMerge();
+	testBloom();
+	testVersioned();
+#ifdef HASHMAP_STATS
+	testStats();
+#endif
+
+	if(failures > 0)
+	{
+		std::cerr << failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "All checks passed\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,652 @@
+#ifndef CPP_EX3_INTHASHMAP_HPP
+#define CPP_EX3_INTHASHMAP_HPP
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include "HashMap.hpp"
+
+#define INT_MAX_LOAD 0.875
+
+/**
+ * HashMap for integer keys. Pairs are stored inline in one slot array probed
+ * linearly, and an empty slot is marked by holding EmptyKey, so there are
+ * no buckets, no control bytes and no per slot flags. Slots are picked by
+ * Fibonacci hashing, the high bits of key * 2^64 / phi, which spreads
+ * sequential and strided keys alike. Erasing shifts the rest of the probe
+ * run back, so no tombstones are left. EmptyKey itself can't be stored, and
+ * ValueT must be default constructible since empty slots hold ValueT().
+ * The public API mirrors HashMap so the two can be swapped for each other.
+ * @tparam KeyT integral type of key
+ * @tparam ValueT type of value
+ * @tparam EmptyKey key value reserved to mark empty slots
+ */
+template <class KeyT, class ValueT, KeyT EmptyKey = std::numeric_limits<KeyT>::max()>
+class IntHashMap
+{
+	static_assert(std::is_integral<KeyT>::value, "IntHashMap requires an integral key type");
+	static_assert(std::is_default_constructible<ValueT>::value, "IntHashMap requires a default constructible value");
+
+public:
+	typedef pair<KeyT, ValueT> value_type;
+
+	/**
+	 * Constructor that receives upper and lower load factors. The upper bound
+	 * is capped at INT_MAX_LOAD since linear probing degrades past it
+	 * @param dLower lower bound
+	 * @param dUpper upper bound
+	 */
+	IntHashMap(double dLower, double dUpper):
+			_dLower(dLower),
+			_dUpper(dUpper < INT_MAX_LOAD ? dUpper : INT_MAX_LOAD),
+			_iSize(DEF_SIZE)
+	{
+		_allocate(DEF_CAP);
+	}
+
+	/**
+	 * Default constructor, empty map with fUpper = 0.75 and fLower = 0.25
+	 */
+	IntHashMap(): IntHashMap(DEF_LOWER, DEF_UPPER) {}
+
+	/**
+	 * Constructor that receives a key vector and a value vector,
+	 * creates map of keys and values with corresponding indices
+	 * @param keyVec vector of keys
+	 * @param valVec vector of values
+	 */
+	IntHashMap(const vector<KeyT> &keyVec, const vector<ValueT> &valVec): IntHashMap()
+	{
+		if(keyVec.size() != valVec.size())
+		{
+			throw differentVectorSizes("Vectors are of different sizes");
+		}
+
+		reserve((int) keyVec.size());
+		for(unsigned long i = 0; i < keyVec.size(); ++i)
+		{
+			insert(keyVec[i], valVec[i]);
+		}
+	}
+
+	IntHashMap(const IntHashMap &other) = default;
+
+	/**
+	 * Move constructor, steals the slots of other and leaves it empty without
+	 * slots. Slots are allocated again on its next insertion
+	 * @param other
+	 */
+	IntHashMap(IntHashMap &&other) noexcept:
+			_dLower(other._dLower),
+			_dUpper(other._dUpper),
+			_iSize(other._iSize),
+			_iShift(other._iShift),
+			_slots(std::move(other._slots))
+	{
+		other._slots.clear();
+		other._iSize = DEF_SIZE;
+	}
+
+	IntHashMap& operator=(const IntHashMap &other) = default;
+
+	/**
+	 * Overload for move = operator, steals the slots of other
+	 * @param other map to move from
+	 * @return reference to map
+	 */
+	IntHashMap& operator=(IntHashMap &&other) noexcept
+	{
+		if(this != &other)
+		{
+			_dLower = other._dLower;
+			_dUpper = other._dUpper;
+			_iSize = other._iSize;
+			_iShift = other._iShift;
+			_slots = std::move(other._slots);
+			other._slots.clear();
+			other._iSize = DEF_SIZE;
+		}
+
+		return *this;
+	}
+
+	/**
+	 * Get amount of cells currently occupied
+	 * @return
+	 */
+	int size() const
+	{
+		return _iSize;
+	}
+
+	/**
+	 * Get the amount of slots
+	 * @return
+	 */
+	int capacity() const
+	{
+		return (int) _slots.size();
+	}
+
+	/**
+	 * Get current load factor (size / capacity)
+	 * @return
+	 */
+	double getLoadFactor() const
+	{
+		return _slots.empty() ? 0 : (double) _iSize / _slots.size();
+	}
+
+	/**
+	 * Check if map is empty
+	 * @return true if empty, otherwise false
+	 */
+	bool empty() const
+	{
+		return _iSize == 0;
+	}
+
+	/**
+	 * Check if map contains given key
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool containsKey(KeyT key) const
+	{
+		return _find(key) >= 0;
+	}
+
+	/**
+	 * Look up the value bound to key
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present. The pointer
+	 * is invalidated by any later insertion or erasure
+	 */
+	ValueT* find(KeyT key)
+	{
+		long idx = _find(key);
+		return idx < 0 ? nullptr : &_slots[idx].second;
+	}
+
+	/**
+	 * Look up the value bound to key
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	const ValueT* find(KeyT key) const
+	{
+		long idx = _find(key);
+		return idx < 0 ? nullptr : &_slots[idx].second;
+	}
+
+	/**
+	 * Make room for at least n pairs without rehashing on the way
+	 * @param n amount of pairs
+	 */
+	void reserve(int n)
+	{
+		size_t cap = _slots.empty() ? DEF_CAP : _slots.size();
+		while(n >= cap * _dUpper)
+		{
+			cap *= 2;
+		}
+
+		if(cap != _slots.size())
+		{
+			_rehash(cap);
+		}
+	}
+
+	/**
+	 * Insert given item to map. Throws exception if key is EmptyKey
+	 * @param key key of item
+	 * @param value value of item
+	 * @return true if successfully inserted, otherwise false
+	 */
+	bool insert(KeyT key, ValueT value)
+	{
+		return try_emplace(key, std::move(value)).second;
+	}
+
+	/**
+	 * Insert a value constructed from args if key is not present, otherwise
+	 * leave the map untouched. Throws exception if key is EmptyKey
+	 * @param key key to look up
+	 * @param args arguments forwarded to the constructor of ValueT
+	 * @return pointer to the value bound to key and true if it was inserted,
+	 * false if key was already present
+	 */
+	template <class... Args>
+	pair<ValueT*, bool> try_emplace(KeyT key, Args&&... args)
+	{
+		if(key == EmptyKey)
+		{
+			throw invalidKeyException("Key is reserved for empty slots");
+		}
+
+		long found = _find(key);
+		if(found >= 0)
+		{
+			return pair<ValueT*, bool>(&_slots[found].second, false);
+		}
+
+		/* Built before the map changes, so a throwing constructor leaves it as is */
+		ValueT value(std::forward<Args>(args)...);
+		if(_slots.empty() || _iSize + 1 > _slots.size() * _dUpper)
+		{
+			_rehash(_slots.empty() ? DEF_CAP : _slots.size() * UPPER_FACTOR);
+		}
+
+		size_t mask = _slots.size() - 1;
+		size_t idx = _home(key);
+		while(_slots[idx].first != EmptyKey)
+		{
+			idx = (idx + 1) & mask;
+		}
+
+		_slots[idx].second = std::move(value);
+		_slots[idx].first = key;
+		_iSize++;
+		return pair<ValueT*, bool>(&_slots[idx].second, true);
+	}
+
+	/**
+	 * Bind value to key, overwriting the current value if key is present
+	 * @param key key to assign
+	 * @param value value to bind
+	 * @return true if key was inserted, false if an existing value was assigned
+	 */
+	bool insert_or_assign(KeyT key, const ValueT &value)
+	{
+		pair<ValueT*, bool> result = try_emplace(key, value);
+		if(!result.second)
+		{
+			*result.first = value;
+		}
+
+		return result.second;
+	}
+
+	/**
+	 * Get value at key in map. Throws exception if key not present
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
+	 */
+	ValueT at(KeyT key) const
+	{
+		long idx = _find(key);
+		if(idx < 0)
+		{
+			throw invalidKeyException("Key not present in map");
+		}
+
+		return _slots[idx].second;
+	}
+
+	/**
+	 * Erase value bound to key
+	 * @param key key to look up
+	 * @return true if value successfully erased, otherwise false
+	 */
+	bool erase(KeyT key)
+	{
+		long idx = _find(key);
+		if(idx < 0)
+		{
+			return false;
+		}
+
+		_unlink((size_t) idx);
+		_iSize--;
+
+		if(_slots.size() > DEF_CAP && _iSize < _slots.size() * _dLower)
+		{
+			_rehash(_slots.size() * LOWER_FACTOR);
+		}
+
+		return true;
+	}
+
+	/**
+	 * Get the length of the probe run the key hashes into, the open
+	 * addressing counterpart of HashMap::bucketSize()
+	 * @param key key to look up
+	 * @return
+	 */
+	int bucketSize(KeyT key) const
+	{
+		if(_slots.empty())
+		{
+			return 0;
+		}
+
+		size_t mask = _slots.size() - 1;
+		int count = 0;
+		for(size_t idx = _home(key); _slots[idx].first != EmptyKey; idx = (idx + 1) & mask)
+		{
+			++count;
+		}
+
+		return count;
+	}
+
+	/**
+	 * Erase all pairs from map, keeps the current capacity
+	 */
+	void clear()
+	{
+		_slots.assign(_slots.size(), value_type(EmptyKey, ValueT()));
+		_iSize = DEF_SIZE;
+	}
+
+	/**
+	 * Overload for [] operator, returns value corresponding to given key.
+	 * Throws exception if key not present
+	 * @param key key to look up
+	 * @return value attached to key
+	 */
+	const ValueT& operator[](KeyT key) const
+	{
+		const ValueT *value = find(key);
+		if(value == nullptr)
+		{
+			throw invalidKeyException("Key not present in map");
+		}
+
+		return *value;
+	}
+
+	/**
+	 * Overload for [] operator, creates new pair if key not present
+	 * @param key key to assign
+	 * @return reference to value
+	 */
+	ValueT& operator[](KeyT key)
+	{
+		return *try_emplace(key).first;
+	}
+
+	/**
+	 * Overload for == operator, checks that all fields are equal
+	 * @param other map to compare to
+	 * @return true if all fields are equal, otherwise false
+	 */
+	bool operator==(const IntHashMap &other) const
+	{
+		if(_iSize != other._iSize ||
+		   _slots.size() != other._slots.size() ||
+		   _dUpper != other._dUpper ||
+		   _dLower != other._dLower)
+		{
+			return false;
+		}
+
+		for(const value_type &item: other)
+		{
+			const ValueT *value = find(item.first);
+			if(value == nullptr || !(*value == item.second))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Overload for != operator
+	 * @param other map to compare to
+	 * @return opposite of ==
+	 */
+	bool operator!=(const IntHashMap &other) const
+	{
+		return !(operator==(other));
+	}
+
+	/**
+	 * Nested Iterator class, walks the slots and stops on full ones
+	 */
+	class const_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef pair<KeyT, ValueT> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const value_type* pointer;
+		typedef const value_type& reference;
+
+		/**
+		 * Constructor that accepts the slots of the map
+		 * @param cur slot to start from
+		 * @param end slot past the last one
+		 */
+		const_iterator(const value_type *cur, const value_type *end): _cur(cur), _end(end)
+		{
+			_skipEmpty();
+		}
+
+		/**
+		 * Prefix increment operator, moves to the next full slot
+		 * @return next element in iteration
+		 */
+		const_iterator& operator++()
+		{
+			++_cur;
+			_skipEmpty();
+			return *this;
+		}
+
+		/**
+		 * Postfix increment operator
+		 * @return element before the increment
+		 */
+		const const_iterator operator++(int)
+		{
+			const_iterator temp = *this;
+			operator++();
+			return temp;
+		}
+
+		/**
+		 * Overload for dereference * operator
+		 * @return the item in the map to which the iterator points
+		 */
+		const value_type& operator*() const
+		{
+			return *_cur;
+		}
+
+		/**
+		 * Overload for -> operator
+		 * @return
+		 */
+		const value_type* operator->() const
+		{
+			return _cur;
+		}
+
+		/**
+		 * Overload for == operator
+		 * @param other iterator to compare to
+		 * @return true if iterators point to the same slot, otherwise false
+		 */
+		bool operator==(const const_iterator &other) const
+		{
+			return _cur == other._cur;
+		}
+
+		/**
+		 * Overload for != operator
+		 * @param other iterator to compare to
+		 * @return opposite of ==
+		 */
+		bool operator!=(const const_iterator &other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		/**
+		 * Advance to the first full slot at or after the current one
+		 */
+		void _skipEmpty()
+		{
+			while(_cur != _end && _cur -> first == EmptyKey)
+			{
+				++_cur;
+			}
+		}
+
+		const value_type *_cur;
+		const value_type *_end;
+	};
+
+	/**
+	 * Returns first element in iteration
+	 * @return
+	 */
+	const_iterator begin() const
+	{
+		return const_iterator(_slots.data(), _slots.data() + _slots.size());
+	}
+
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator end() const
+	{
+		return const_iterator(_slots.data() + _slots.size(), _slots.data() + _slots.size());
+	}
+
+	/**
+	 * Returns first element in iteration
+	 * @return
+	 */
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator cend() const
+	{
+		return end();
+	}
+
+private:
+	/**
+	 * Get the slot a key hashes to, the top bits of key times 2^64 / phi
+	 * @param key
+	 * @return
+	 */
+	size_t _home(KeyT key) const
+	{
+		return (size_t) (((uint64_t) key * 0x9E3779B97F4A7C15ULL) >> _iShift);
+	}
+
+	/**
+	 * Find the slot holding key
+	 * @param key key to look up
+	 * @return slot, or -1 if key not present
+	 */
+	long _find(KeyT key) const
+	{
+		if(_slots.empty() || key == EmptyKey)
+		{
+			return -1;
+		}
+
+		size_t mask = _slots.size() - 1;
+		for(size_t idx = _home(key); _slots[idx].first != EmptyKey; idx = (idx + 1) & mask)
+		{
+			if(_slots[idx].first == key)
+			{
+				return (long) idx;
+			}
+		}
+
+		return -1;
+	}
+
+	/**
+	 * Empty a slot without leaving a tombstone, by moving back every later
+	 * slot of the run that may live closer to its home
+	 * @param idx
+	 */
+	void _unlink(size_t idx)
+	{
+		size_t mask = _slots.size() - 1;
+		size_t hole = idx;
+		for(size_t next = (idx + 1) & mask; _slots[next].first != EmptyKey; next = (next + 1) & mask)
+		{
+			size_t home = _home(_slots[next].first);
+			if(((next - home) & mask) >= ((next - hole) & mask))
+			{
+				_slots[hole] = std::move(_slots[next]);
+				hole = next;
+			}
+		}
+
+		_slots[hole].first = EmptyKey;
+		_slots[hole].second = ValueT();
+	}
+
+	/**
+	 * Point the map at new, empty slots
+	 * @param cap amount of slots, a power of two
+	 */
+	void _allocate(size_t cap)
+	{
+		_slots.assign(cap, value_type(EmptyKey, ValueT()));
+		_iShift = 64;
+		for(size_t bit = 1; bit < cap; bit *= 2)
+		{
+			--_iShift;
+		}
+	}
+
+	/**
+	 * Move every pair into new slots of given capacity
+	 * @param cap new capacity, rounded up to a power of two no smaller than
+	 * DEF_CAP and big enough for the current pairs
+	 */
+	void _rehash(size_t cap)
+	{
+		size_t newCap = DEF_CAP;
+		while(newCap < cap || _iSize >= newCap * _dUpper)
+		{
+			newCap *= 2;
+		}
+
+		vector<value_type> oldSlots(std::move(_slots));
+		_allocate(newCap);
+
+		size_t mask = newCap - 1;
+		for(value_type &item: oldSlots)
+		{
+			if(item.first != EmptyKey)
+			{
+				size_t idx = _home(item.first);
+				while(_slots[idx].first != EmptyKey)
+				{
+					idx = (idx + 1) & mask;
+				}
+
+				_slots[idx] = std::move(item);
+			}
+		}
+	}
+
+	double _dLower;
+	double _dUpper;
+	int _iSize;
+	int _iShift;
+	vector<value_type> _slots;
+};
+
+#endif //CPP_EX3_INTHASHMAP_HPP
@@ -0,0 +1,268 @@
+#ifndef CPP_EX3_MESSAGESCORER_HPP
+#define CPP_EX3_MESSAGESCORER_HPP
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AhoCorasick.hpp"
+#include "MessageTokenizer.hpp"
+
+/**
+ * Lower case a char
+ * @param letter char to convert
+ * @return lower case version of letter
+ */
+inline char lowerLetter(char letter)
+{
+	return (letter >= 'A' && letter <= 'Z') ? letter + 32 : letter;
+}
+
+/**
+ * Check if a lower case char is a letter
+ * @param letter char to check
+ * @return
+ */
+inline bool isLowerLetter(char letter)
+{
+	return letter >= 'a' && letter <= 'z';
+}
+
+/**
+ * Append a word read from a message to text, normalized: lower cased, and
+ * without its first and last chars if they are not letters
+ * @param text text to append to
+ * @param word word to normalize
+ */
+inline void appendNormalized(std::string &text, std::string_view word)
+{
+	/* Remove punctuation marks from start of word */
+	if(!word.empty() && !isLowerLetter(lowerLetter(word[0])))
+	{
+		word.remove_prefix(1);
+	}
+	
+	/* Remove any punctuation marks from end of word */
+	if(!word.empty() && !isLowerLetter(lowerLetter(word[word.length() - 1])))
+	{
+		word.remove_suffix(1);
+	}
+	
+	for(char letter: word)
+	{
+		text += lowerLetter(letter);
+	}
+}
+
+/**
+ * Verdict on a message
+ */
+struct Verdict
+{
+	/**
+	 * Score of the message, or of the part read before scanning stopped early
+	 */
+	int score;
+	bool isSpam;
+	/**
+	 * Byte offset in the message right after the word that decided the
+	 * verdict: the word that brought the score to the threshold, or the end
+	 * of the message if it never got there
+	 */
+	size_t offset;
+};
+
+/**
+ * Scores a message fed to it a word at a time.
+ *
+ * Every word of the message starts a phrase, which grows a word at a time
+ * until it is in the database, and the value of that shortest phrase is
+ * added to the score. Phrases are built as "key += ' ' + word", dropping the
+ * first char of key whenever it is not a letter, so the phrase of words i..j
+ * is their text joined by spaces minus min(j - i, length of its leading run
+ * of non letters) chars. The words are joined into one text and scanned once
+ * by the automaton, and each phrase ending at the end of word j is checked
+ * against the starts it could belong to. Values are never negative, so the
+ * score only grows as words are added
+ */
+class MessageScorer
+{
+public:
+	/**
+	 * Constructor that receives the phrases to score by
+	 * @param phrases automaton of the bad phrases and their scores
+	 */
+	explicit MessageScorer(const AhoCorasick &phrases):
+			_phrases(phrases),
+			_state(AhoCorasick::start()),
+			_iPos(0),
+			_iPending(0),
+			_iScore(0)
+	{
+	}
+
+	/**
+	 * Add the next word of the message
+	 * @param word word as read from the message, normalized here
+	 * @param isStart whether phrases may start at this word
+	 */
+	void addWord(std::string_view word, bool isStart)
+	{
+		if(!_starts.empty())
+		{
+			_text += ' ';
+		}
+
+		_starts.push_back((int) _text.length());
+		_firstLetter.push_back(INT_MAX);
+		_matched.push_back(!isStart);
+		appendNormalized(_text, word);
+		_ends.push_back((int) _text.length());
+
+		int j = (int) _ends.size() - 1;
+		for(; _iPos < _ends[j]; ++_iPos)
+		{
+			_state = _phrases.step(_state, _text[_iPos]);
+			if(isLowerLetter(_text[_iPos]))
+			{
+				for(; _iPending < (int) _starts.size(); ++_iPending)
+				{
+					_firstLetter[_iPending] = _iPos;
+				}
+			}
+		}
+
+		_phrases.forEachMatch(_state, [&](int length, int value)
+		{
+			_addMatch(j, _ends[j] - length, value);
+		});
+	}
+
+	/**
+	 * Score a message ending in whitespace as the original reader scored it:
+	 * after the last word its failed read left that word in place, so every
+	 * phrase still running got the last word, normalized again, appended once
+	 * more, and the last word was looked up again as a phrase of its own
+	 */
+	void addTrailingSpace()
+	{
+		if(_starts.empty())
+		{
+			return;
+		}
+
+		int lastLength = _ends.back() - _starts.back();
+		const int *value = _phrases.find(std::string_view(_text).substr(_starts.back(), lastLength));
+		if(value != nullptr)
+		{
+			_iScore += *value;
+		}
+
+		if(lastLength > 0)
+		{
+			/* Copied out first, appending may move the text */
+			std::string last = _text.substr(_starts.back(), lastLength);
+			addWord(last, false);
+		}
+	}
+
+	/**
+	 * Get the score of the words added so far
+	 * @return
+	 */
+	int score() const
+	{
+		return _iScore;
+	}
+
+private:
+	/**
+	 * Add the value of a phrase ending at word j to every start it is the
+	 * first phrase of
+	 * @param j word the phrase ends at
+	 * @param phraseStart position of the phrase in the text
+	 * @param value value of the phrase
+	 */
+	void _addMatch(int j, int phraseStart, int value)
+	{
+		int i = (int) (std::upper_bound(_starts.begin(), _starts.begin() + j + 1, phraseStart) - _starts.begin()) - 1;
+
+		/* Starts further back drop at most one char per word */
+		for(; i >= 0 && phraseStart - _starts[i] <= j - i; --i)
+		{
+			if(_matched[i])
+			{
+				continue;
+			}
+
+			int run = std::min(_firstLetter[i], _ends[j]) - _starts[i];
+			if(_starts[i] + std::min(j - i, run) == phraseStart)
+			{
+				_matched[i] = true;
+				_iScore += value;
+			}
+		}
+	}
+
+	const AhoCorasick &_phrases;
+	int _state;
+	int _iPos;
+	int _iPending;
+	int _iScore;
+	/* Normalized words joined by spaces, _starts[i] and _ends[i] delimit word i */
+	std::string _text;
+	std::vector<int> _starts;
+	std::vector<int> _ends;
+	/* First letter at or after the start of word i, INT_MAX if none yet */
+	std::vector<int> _firstLetter;
+	/* Whether word i already started a phrase in the database, or can't start one */
+	std::vector<bool> _matched;
+};
+
+/**
+ * Score a message. Stopping early saves reading the rest of a message
+ * once it is spam, since its score can only grow
+ * @param fileName file to check for spam
+ * @param phrases automaton of the bad phrases and their scores
+ * @param threshold threshold for spam score
+ * @param stopEarly true to stop reading once the score reaches threshold
+ * @return verdict on the file
+ */
+inline Verdict scoreMessage(const std::string &fileName, const AhoCorasick &phrases, int threshold, bool stopEarly)
+{
+	MessageTokenizer tokenizer(fileName);
+	MessageScorer scorer(phrases);
+	Verdict verdict{0, false, 0};
+	std::string_view word;
+	while(tokenizer.next(word))
+	{
+		scorer.addWord(word, true);
+		if(!verdict.isSpam && scorer.score() >= threshold)
+		{
+			verdict.isSpam = true;
+			verdict.offset = tokenizer.offset();
+			if(stopEarly)
+			{
+				verdict.score = scorer.score();
+				return verdict;
+			}
+		}
+	}
+
+	if(tokenizer.trailingSpace())
+	{
+		scorer.addTrailingSpace();
+	}
+
+	verdict.score = scorer.score();
+	if(!verdict.isSpam)
+	{
+		verdict.isSpam = verdict.score >= threshold;
+		verdict.offset = tokenizer.offset();
+	}
+
+	return verdict;
+}
+
+#endif //CPP_EX3_MESSAGESCORER_HPP
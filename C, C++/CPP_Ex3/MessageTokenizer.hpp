@@ -0,0 +1,145 @@
+#ifndef CPP_EX3_MESSAGETOKENIZER_HPP
+#define CPP_EX3_MESSAGETOKENIZER_HPP
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Splits a file into words separated by whitespace, as reading it with
+ * "file >> word" would. The file is mmap()ed and every word is a
+ * std::string_view into the mapping, so no word is copied or allocated.
+ * Files that can't be mapped (empty files, pipes) are read into a buffer
+ */
+class MessageTokenizer
+{
+public:
+	/**
+	 * Constructor that opens the file. A file that can't be opened has no words
+	 * @param fileName path of the file
+	 */
+	explicit MessageTokenizer(const std::string &fileName):
+			_data(nullptr),
+			_bytes(0),
+			_pos(0),
+			_bMapped(false),
+			_bTrailingSpace(false)
+	{
+		int fd = open(fileName.c_str(), O_RDONLY);
+		struct stat info;
+		if(fd >= 0 && fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+		{
+			void *addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(addr != MAP_FAILED)
+			{
+				madvise(addr, info.st_size, MADV_SEQUENTIAL);
+				_data = static_cast<const char*>(addr);
+				_bytes = info.st_size;
+				_bMapped = true;
+			}
+		}
+
+		if(fd >= 0)
+		{
+			close(fd);
+		}
+
+		if(!_bMapped)
+		{
+			std::ifstream file(fileName, std::ios::binary);
+			_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			_data = _buffer.data();
+			_bytes = _buffer.size();
+		}
+	}
+
+	MessageTokenizer(const MessageTokenizer &other) = delete;
+
+	MessageTokenizer& operator=(const MessageTokenizer &other) = delete;
+
+	/**
+	 * Destructor, unmaps the file if it was mapped
+	 */
+	~MessageTokenizer()
+	{
+		if(_bMapped)
+		{
+			munmap(const_cast<char*>(_data), _bytes);
+		}
+	}
+
+	/**
+	 * Get the next word
+	 * @param word set to the next word, valid as long as this tokenizer
+	 * @return true if there was a word, false at the end of the file
+	 */
+	bool next(std::string_view &word)
+	{
+		while(_pos < _bytes && isSpace(_data[_pos]))
+		{
+			++_pos;
+		}
+
+		if(_pos == _bytes)
+		{
+			return false;
+		}
+
+		size_t start = _pos;
+		while(_pos < _bytes && !isSpace(_data[_pos]))
+		{
+			++_pos;
+		}
+
+		word = std::string_view(_data + start, _pos - start);
+		_bTrailingSpace = _pos < _bytes;
+		return true;
+	}
+
+	/**
+	 * Check if the last word returned by next() was followed by whitespace,
+	 * i.e. if reading it with "file >> word" would not have hit the end of
+	 * the file
+	 * @return
+	 */
+	bool trailingSpace() const
+	{
+		return _bTrailingSpace;
+	}
+
+	/**
+	 * Get the byte offset right after the last word returned by next(), or
+	 * the size of the file once next() returned false
+	 * @return
+	 */
+	size_t offset() const
+	{
+		return _pos;
+	}
+
+	/**
+	 * Check if a char is whitespace in the "C" locale, the chars "file >> word"
+	 * stops at
+	 * @param letter char to check
+	 * @return
+	 */
+	static bool isSpace(char letter)
+	{
+		return letter == ' ' || (letter >= '\t' && letter <= '\r');
+	}
+
+private:
+	const char *_data;
+	size_t _bytes;
+	size_t _pos;
+	bool _bMapped;
+	bool _bTrailingSpace;
+	std::string _buffer;
+};
+
+#endif //CPP_EX3_MESSAGETOKENIZER_HPP
@@ -0,0 +1,217 @@
+#ifndef CPP_EX3_MONOTONICARENA_HPP
+#define CPP_EX3_MONOTONICARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#define DEF_BLOCK_SIZE 4096
+#define MAX_BLOCK_SIZE (1 << 24)
+
+/**
+ * Monotonic arena, hands out memory by bumping a pointer through large blocks
+ * and never frees individual allocations. Every block is released at once by
+ * release() or by the destructor. Blocks double in size up to MAX_BLOCK_SIZE,
+ * so filling an arena takes a logarithmic amount of calls to operator new
+ */
+class MonotonicArena
+{
+public:
+	/**
+	 * Constructor that receives the size of the first block
+	 * @param blockSize size of the first block in bytes
+	 */
+	explicit MonotonicArena(size_t blockSize = DEF_BLOCK_SIZE):
+			_head(nullptr),
+			_cur(nullptr),
+			_end(nullptr),
+			_blockSize(blockSize),
+			_bytesAllocated(0)
+	{
+	}
+
+	MonotonicArena(const MonotonicArena &other) = delete;
+
+	MonotonicArena& operator=(const MonotonicArena &other) = delete;
+
+	/**
+	 * Destructor, releases all blocks
+	 */
+	~MonotonicArena()
+	{
+		release();
+	}
+
+	/**
+	 * Get memory from the arena
+	 * @param bytes amount of bytes
+	 * @param align required alignment, a power of two
+	 * @return pointer to the memory
+	 */
+	void* allocate(size_t bytes, size_t align)
+	{
+		uintptr_t cur = ((uintptr_t) _cur + align - 1) & ~(uintptr_t) (align - 1);
+		if(_cur == nullptr || cur + bytes > (uintptr_t) _end)
+		{
+			_newBlock(bytes + align);
+			cur = ((uintptr_t) _cur + align - 1) & ~(uintptr_t) (align - 1);
+		}
+
+		_cur = (char*) (cur + bytes);
+		return (void*) cur;
+	}
+
+	/**
+	 * Free every block, invalidating all memory handed out so far. Objects
+	 * living in the arena are not destroyed
+	 */
+	void release()
+	{
+		while(_head != nullptr)
+		{
+			Block *next = _head -> next;
+			::operator delete(_head);
+			_head = next;
+		}
+
+		_cur = nullptr;
+		_end = nullptr;
+		_bytesAllocated = 0;
+	}
+
+	/**
+	 * Get the amount of bytes taken from operator new by this arena
+	 * @return
+	 */
+	size_t bytesAllocated() const
+	{
+		return _bytesAllocated;
+	}
+
+private:
+	/**
+	 * Header at the start of every block, links the blocks for release()
+	 */
+	struct Block
+	{
+		Block *next;
+	};
+
+	/**
+	 * Allocate a block big enough for minBytes and make it current
+	 * @param minBytes amount of bytes the block must fit after its header
+	 */
+	void _newBlock(size_t minBytes)
+	{
+		size_t size = _blockSize;
+		while(size < minBytes + sizeof(Block))
+		{
+			size *= 2;
+		}
+
+		Block *block = static_cast<Block*>(::operator new(size));
+		block -> next = _head;
+		_head = block;
+		_cur = (char*) block + sizeof(Block);
+		_end = (char*) block + size;
+		_bytesAllocated += size;
+
+		if(_blockSize < MAX_BLOCK_SIZE)
+		{
+			_blockSize *= 2;
+		}
+	}
+
+	Block *_head;
+	char *_cur;
+	char *_end;
+	size_t _blockSize;
+	size_t _bytesAllocated;
+};
+
+/**
+ * Standard allocator drawing from a MonotonicArena. deallocate() does nothing,
+ * memory comes back when the arena is released
+ * @tparam T type of allocated objects
+ */
+template <class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	/**
+	 * Marks the allocator as never reclaiming memory, so containers may skip
+	 * destroying trivially destructible contents
+	 */
+	typedef std::true_type is_monotonic;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	/**
+	 * Constructor that receives the arena to allocate from
+	 * @param arena
+	 */
+	ArenaAllocator(MonotonicArena &arena) noexcept: _arena(&arena) {}
+
+	/**
+	 * Converting constructor from an allocator of another type
+	 * @param other
+	 */
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U> &other) noexcept: _arena(other.arena()) {}
+
+	/**
+	 * Allocate room for n objects of type T
+	 * @param n
+	 * @return
+	 */
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(_arena -> allocate(n * sizeof(T), alignof(T)));
+	}
+
+	/**
+	 * Does nothing, the arena frees everything at once
+	 */
+	void deallocate(T*, size_t) noexcept
+	{
+	}
+
+	/**
+	 * Get the arena of this allocator
+	 * @return
+	 */
+	MonotonicArena* arena() const noexcept
+	{
+		return _arena;
+	}
+
+	/**
+	 * Overload for == operator, allocators are equal if they share an arena
+	 * @param other allocator to compare to
+	 * @return
+	 */
+	template <class U>
+	bool operator==(const ArenaAllocator<U> &other) const noexcept
+	{
+		return _arena == other.arena();
+	}
+
+	/**
+	 * Overload for != operator
+	 * @param other allocator to compare to
+	 * @return opposite of ==
+	 */
+	template <class U>
+	bool operator!=(const ArenaAllocator<U> &other) const noexcept
+	{
+		return _arena != other.arena();
+	}
+
+private:
+	MonotonicArena *_arena;
+};
+
+#endif //CPP_EX3_MONOTONICARENA_HPP
@@ -0,0 +1,495 @@
+#ifndef CPP_EX3_PERFECTHASHMAP_HPP
+#define CPP_EX3_PERFECTHASHMAP_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "HashMap.hpp"
+
+#define PERFECT_BUCKET_SIZE 4
+#define MAX_DISPLACEMENT (1 << 20)
+#define MAX_SEEDS 16
+
+/**
+ * Exception to be thrown when no perfect hash could be built for a set of keys
+ */
+class buildFailedException: public std::exception
+{
+public:
+	/**
+	 * Constructor that prints a message
+	 * @param message
+	 */
+	explicit buildFailedException(char const* msg): _msg(msg) {}
+
+	const char* what() const noexcept override
+	{
+		return _msg.c_str();
+	}
+
+private:
+	std::string _msg;
+};
+
+/**
+ * Immutable map over a fixed set of keys, built once with a minimal perfect
+ * hash in the style of hash-and-displace (CHD). n pairs are stored in exactly
+ * n slots, every key is sent to a bucket of about PERFECT_BUCKET_SIZE keys,
+ * and each bucket keeps one displacement that moves all its keys to free
+ * slots. Buckets of a single key store their slot directly. A lookup reads
+ * one displacement, one slot and compares one key
+ * @tparam KeyT type of key
+ * @tparam ValueT type of value
+ * @tparam Hash hash functor for keys
+ * @tparam KeyEqual equality functor for keys
+ */
+template <class KeyT, class ValueT, class Hash = KeyHash<KeyT>, class KeyEqual = std::equal_to<>>
+class PerfectHashMap
+{
+	/**
+	 * Enables the lookup overloads taking a key of type K other than KeyT,
+	 * only available when both the hash and the equality are transparent
+	 */
+	template <class K>
+	using heterogeneousKey = typename std::enable_if<isTransparent<Hash>::value &&
+	                                                 isTransparent<KeyEqual>::value &&
+	                                                 !std::is_same<K, KeyT>::value, int>::type;
+
+public:
+	typedef pair<KeyT, ValueT> value_type;
+	typedef typename vector<value_type>::const_iterator const_iterator;
+
+	/**
+	 * Constructor that builds the map from a range of pairs. When a key
+	 * appears more than once the first pair wins, like HashMap::insert().
+	 * Throws buildFailedException if no perfect hash is found, which only
+	 * happens when distinct keys have the same hash
+	 * @param first start of the range
+	 * @param last end of the range
+	 */
+	template <class InputIt, class = typename std::iterator_traits<InputIt>::iterator_category>
+	PerfectHashMap(InputIt first, InputIt last): _seed(0), _slotAmt(0)
+	{
+		vector<value_type> items;
+		for(; first != last; ++first)
+		{
+			items.emplace_back(*first);
+		}
+
+		_build(items);
+	}
+
+	/**
+	 * Constructor that builds the map from the pairs of a finished HashMap
+	 * @param map
+	 */
+	template <class H, class E, bool C, class A>
+	explicit PerfectHashMap(const HashMap<KeyT, ValueT, H, E, C, A> &map): _seed(0), _slotAmt(0)
+	{
+		vector<value_type> items;
+		items.reserve(map.size());
+		for(auto it = map.begin(); it != map.end(); ++it)
+		{
+			items.emplace_back(*it);
+		}
+
+		_build(items);
+	}
+
+	/**
+	 * Get amount of pairs in the map
+	 * @return
+	 */
+	int size() const
+	{
+		return (int) _entries.size();
+	}
+
+	/**
+	 * Check if map is empty
+	 * @return true if empty, otherwise false
+	 */
+	bool empty() const
+	{
+		return _entries.empty();
+	}
+
+	/**
+	 * Get amount of bytes used by the perfect hash itself, on top of the pairs
+	 * @return
+	 */
+	size_t overheadBytes() const
+	{
+		return _displace.size() * sizeof(int32_t);
+	}
+
+	/**
+	 * Check if map contains given key
+	 * @param key key to look up
+	 * @return true if key is present in map, otherwise false
+	 */
+	bool containsKey(const KeyT &key) const
+	{
+		return _find(key) != nullptr;
+	}
+
+	/**
+	 * Check if map contains a key equal to key, without converting it to KeyT
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return true if key is present in map, otherwise false
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	bool containsKey(const K &key) const
+	{
+		return _find(key) != nullptr;
+	}
+
+	/**
+	 * Look up the value bound to key
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	const ValueT* find(const KeyT &key) const
+	{
+		return _find(key);
+	}
+
+	/**
+	 * Look up the value bound to a key equal to key
+	 * @param key key to look up, e.g. a std::string_view for string keys
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K, heterogeneousKey<K> = 0>
+	const ValueT* find(const K &key) const
+	{
+		return _find(key);
+	}
+
+	/**
+	 * Get value at key in map. Throws exception if key not present
+	 * @param key key to look up
+	 * @return value bound to key, or exception if key not found
+	 */
+	const ValueT& at(const KeyT &key) const
+	{
+		const ValueT *value = _find(key);
+		if(value == nullptr)
+		{
+			throw invalidKeyException("Key not present in map");
+		}
+
+		return *value;
+	}
+
+	/**
+	 * Returns first element in iteration, pairs are in no particular order
+	 * @return
+	 */
+	const_iterator begin() const
+	{
+		return _entries.begin();
+	}
+
+	/**
+	 * Returns the element "one after the last"
+	 * @return
+	 */
+	const_iterator end() const
+	{
+		return _entries.end();
+	}
+
+private:
+	/**
+	 * Mix the bits of a hash. Bucket and slot are both derived from the key
+	 * hash, and std::hash leaves it unmixed for most types
+	 * @param hash
+	 * @return
+	 */
+	static uint64_t _mix(uint64_t hash)
+	{
+		return mixInteger(hash);
+	}
+
+	/**
+	 * Map a hash onto [0, n) without a division
+	 * @param hash
+	 * @param n
+	 * @return
+	 */
+	static uint64_t _reduce(uint64_t hash, uint64_t n)
+	{
+		return (uint64_t) (((unsigned __int128) hash * n) >> 64);
+	}
+
+	/**
+	 * Get the bucket of a key hash under the current seed
+	 * @param hash
+	 * @return
+	 */
+	uint64_t _bucketOf(uint64_t hash) const
+	{
+		return _reduce(_mix(hash ^ _seed), _displace.size());
+	}
+
+	/**
+	 * Get the slot of a key hash under displacement d
+	 * @param hash
+	 * @param d
+	 * @return
+	 */
+	uint64_t _slotOf(uint64_t hash, uint64_t d) const
+	{
+		return _reduce(_mix(hash + _seed + d * 0x9E3779B97F4A7C15ULL), _slotAmt);
+	}
+
+	/**
+	 * Shared implementation of the lookups
+	 * @param key key to look up
+	 * @return pointer to the value, or nullptr if key not present
+	 */
+	template <class K>
+	const ValueT* _find(const K &key) const
+	{
+		if(_entries.empty())
+		{
+			return nullptr;
+		}
+
+		uint64_t hash = _hasher(key);
+		int32_t d = _displace[_bucketOf(hash)];
+		uint64_t slot = d < 0 ? (uint64_t) (-(int64_t) d - 1) : _slotOf(hash, d);
+
+		const value_type &entry = _entries[slot];
+		return _keyEqual(entry.first, key) ? &entry.second : nullptr;
+	}
+
+	/**
+	 * Build the perfect hash for items and move them into their slots.
+	 * Buckets are placed largest first, trying displacements until all keys
+	 * of the bucket land on free slots. If a bucket can't be placed the whole
+	 * build restarts under another seed
+	 * @param items pairs to store, consumed
+	 */
+	void _build(vector<value_type> &items)
+	{
+		vector<uint64_t> hashes;
+		hashes.reserve(items.size());
+		for(const value_type &item: items)
+		{
+			hashes.push_back(_hasher(item.first));
+		}
+
+		for(int attempt = 0; attempt < MAX_SEEDS; ++attempt)
+		{
+			_seed = _mix(attempt + 1);
+			vector<uint64_t> slots;
+			if(_place(items, hashes, slots))
+			{
+				vector<size_t> itemAt(items.size());
+				for(size_t i = 0; i < items.size(); ++i)
+				{
+					itemAt[slots[i]] = i;
+				}
+
+				_entries.reserve(items.size());
+				for(size_t slot = 0; slot < items.size(); ++slot)
+				{
+					_entries.push_back(std::move(items[itemAt[slot]]));
+				}
+
+				return;
+			}
+		}
+
+		throw buildFailedException("No perfect hash found for the given keys");
+	}
+
+	/**
+	 * One attempt at placing all buckets under the current seed. Duplicate
+	 * keys are dropped from items on the way, keeping the first one
+	 * @param items pairs to store
+	 * @param hashes hash of every pair
+	 * @param slots set to the slot of every pair on success
+	 * @return true if every bucket was placed, otherwise false
+	 */
+	bool _place(vector<value_type> &items, vector<uint64_t> &hashes, vector<uint64_t> &slots)
+	{
+		size_t bucketAmt = (items.size() + PERFECT_BUCKET_SIZE - 1) / PERFECT_BUCKET_SIZE;
+		_displace.assign(bucketAmt == 0 ? 1 : bucketAmt, 0);
+
+		/* Counting sort of the items by bucket */
+		vector<size_t> start(_displace.size() + 1, 0);
+		vector<uint64_t> bucketOf(items.size());
+		for(size_t i = 0; i < items.size(); ++i)
+		{
+			bucketOf[i] = _bucketOf(hashes[i]);
+			++start[bucketOf[i] + 1];
+		}
+
+		for(size_t b = 0; b < _displace.size(); ++b)
+		{
+			start[b + 1] += start[b];
+		}
+
+		vector<size_t> order(items.size());
+		vector<size_t> fill(start.begin(), start.end() - 1);
+		for(size_t i = 0; i < items.size(); ++i)
+		{
+			order[fill[bucketOf[i]]++] = i;
+		}
+
+		if(_dropDuplicates(items, hashes, start, order))
+		{
+			return _place(items, hashes, slots);
+		}
+
+		/* Counting sort of the buckets by size, largest first */
+		size_t maxSize = 0;
+		for(size_t b = 0; b < _displace.size(); ++b)
+		{
+			maxSize = std::max(maxSize, start[b + 1] - start[b]);
+		}
+
+		vector<vector<size_t>> bySize(std::max(maxSize + 1, (size_t) 2));
+		for(size_t b = 0; b < _displace.size(); ++b)
+		{
+			bySize[start[b + 1] - start[b]].push_back(b);
+		}
+
+		_slotAmt = items.size();
+		slots.assign(items.size(), 0);
+		vector<bool> taken(items.size(), false);
+		vector<uint64_t> candidate;
+
+		for(size_t size = maxSize; size >= 2; --size)
+		{
+			for(size_t b: bySize[size])
+			{
+				bool placed = false;
+				for(uint64_t d = 0; d < MAX_DISPLACEMENT && !placed; ++d)
+				{
+					candidate.clear();
+					placed = true;
+					for(size_t k = start[b]; k < start[b + 1] && placed; ++k)
+					{
+						uint64_t slot = _slotOf(hashes[order[k]], d);
+						for(uint64_t other: candidate)
+						{
+							placed = placed && other != slot;
+						}
+
+						placed = placed && !taken[slot];
+						candidate.push_back(slot);
+					}
+
+					if(placed)
+					{
+						_displace[b] = (int32_t) d;
+						for(size_t k = start[b]; k < start[b + 1]; ++k)
+						{
+							slots[order[k]] = candidate[k - start[b]];
+							taken[candidate[k - start[b]]] = true;
+						}
+					}
+				}
+
+				if(!placed)
+				{
+					return false;
+				}
+			}
+		}
+
+		/* Single keys take the remaining slots directly */
+		size_t freeSlot = 0;
+		for(size_t b: bySize[1])
+		{
+			while(taken[freeSlot])
+			{
+				++freeSlot;
+			}
+
+			taken[freeSlot] = true;
+			slots[order[start[b]]] = freeSlot;
+			_displace[b] = (int32_t) (-(int64_t) freeSlot - 1);
+		}
+
+		return true;
+	}
+
+	/**
+	 * Remove repeated keys from items. Equal keys share a bucket, so only
+	 * keys within a bucket are compared. Distinct keys with the same hash
+	 * can never be separated, so they abort the build
+	 * @param items pairs to store
+	 * @param hashes hash of every pair
+	 * @param start index in order of the first item of every bucket
+	 * @param order items sorted by bucket
+	 * @return true if items were removed, otherwise false
+	 */
+	bool _dropDuplicates(vector<value_type> &items, vector<uint64_t> &hashes,
+	                     const vector<size_t> &start, const vector<size_t> &order)
+	{
+		vector<bool> drop(items.size(), false);
+		bool dropped = false;
+		for(size_t b = 0; b + 1 < start.size(); ++b)
+		{
+			for(size_t i = start[b]; i < start[b + 1]; ++i)
+			{
+				for(size_t j = start[b]; j < i && !drop[order[i]]; ++j)
+				{
+					if(drop[order[j]] || hashes[order[i]] != hashes[order[j]])
+					{
+						continue;
+					}
+
+					if(!_keyEqual(items[order[i]].first, items[order[j]].first))
+					{
+						throw buildFailedException("Distinct keys with equal hashes");
+					}
+
+					drop[std::max(order[i], order[j])] = true;
+					dropped = true;
+				}
+			}
+		}
+
+		if(dropped)
+		{
+			size_t kept = 0;
+			for(size_t i = 0; i < items.size(); ++i)
+			{
+				if(drop[i])
+				{
+					continue;
+				}
+
+				/* Moving a pair onto itself would empty a string key */
+				if(kept != i)
+				{
+					items[kept] = std::move(items[i]);
+					hashes[kept] = hashes[i];
+				}
+
+				++kept;
+			}
+
+			items.resize(kept);
+			hashes.resize(kept);
+		}
+
+		return dropped;
+	}
+
+	Hash _hasher;
+	KeyEqual _keyEqual;
+	uint64_t _seed;
+	uint64_t _slotAmt;
+	vector<int32_t> _displace;
+	vector<value_type> _entries;
+};
+
+#endif //CPP_EX3_PERFECTHASHMAP_HPP
@@ -1,10 +1,25 @@
 #include <iostream>
 #include "HashMap.hpp"
+#include "AhoCorasick.hpp"
+#include "MessageScorer.hpp"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <system_error>
+#include <thread>
 
 #define VALID_ARGS_AMT 4
+#define BATCH_FLAG "--batch"
+#define EARLY_FLAG "--early"
+#define BATCH_ARGS_AMT 5
+#define INVALID_SCORE -1
+#define COMPILE_CMD "compile"
+#define COMPILE_ARGS_AMT 4
 
 using std::pair;
 using std::string;
@@ -157,21 +172,54 @@ bool isValidFile(const string &fileName)
 }
 
 /**
- * Check if given argument is a valid threshold
- * @param arg argument to check
- * @return true if valid, otherwise false
+ * Parse a positive count, such as a threshold or an amount of threads
+ * @param arg argument to parse
+ * @param count set to the parsed count
+ * @return true if arg is digits only and its value is in 1..INT_MAX,
+ * otherwise false
  */
-bool isValidThreshold(string &arg)
+bool parseCount(const string &arg, int &count)
 {
+	long long value = 0;
+	
 	for(char letter: arg)
 	{
 		if(!(letter >= '0' && letter <= '9'))
 		{
 			return false;
 		}
+		
+		value = value * 10 + (letter - '0');
+		if(value > INT_MAX)
+		{
+			return false;
+		}
 	}
 	
-	return std::stoi(arg) > 0;
+	count = (int) value;
+	return value > 0;
+}
+
+/**
+ * Check if given argument is a valid threshold
+ * @param arg argument to check
+ * @return true if valid, otherwise false
+ */
+bool isValidThreshold(string &arg)
+{
+	int threshold = 0;
+	return parseCount(arg, threshold);
+}
+
+/**
+ * Check if database is valid, a compiled database is checked when it is loaded
+ * @param fileName file containing data
+ * @param words container to store words of a csv database
+ * @return true if compiled or parse successful, otherwise false
+ */
+bool isValidAnyDatabase(const string &fileName, HashMap<string, int> &words)
+{
+	return AhoCorasick::isImageFile(fileName) || isValidDatabase(fileName, words);
 }
 
 /**
@@ -191,7 +239,7 @@ int areValidArgs(int argc, char **argv, HashMap<string, int> &words)
 	
 	string threshold(argv[3]);
 	
-	if(!isValidFile(argv[1]) || !isValidFile(argv[2]) || !isValidThreshold(threshold) || !isValidDatabase(argv[1], words))
+	if(!isValidFile(argv[1]) || !isValidFile(argv[2]) || !isValidThreshold(threshold) || !isValidAnyDatabase(argv[1], words))
 	{
 		std::cerr << "Invalid input\n";
 		return EXIT_FAILURE;
@@ -201,77 +249,235 @@ int areValidArgs(int argc, char **argv, HashMap<string, int> &words)
 }
 
 /**
- * Check if given file is spam or not based on given bad words
- * @param fileName file to check for spam
- * @param words words that add to spam score
- * @param threshold threshold for spam score
- * @return true if spam, otherwise false
+ * Checks if supplied arguments of batch mode are valid
+ * @param argc amount of arguments supplied
+ * @param argv actual arguments
+ * @param words container to store bad words with their score
+ * @return true if valid, otherwise false
  */
-bool isSpam(const string &fileName, HashMap<string, int> &words, int threshold)
+int areValidBatchArgs(int argc, char **argv, HashMap<string, int> &words)
 {
-	HashMap<string, int> myMap;
+	if(argc != BATCH_ARGS_AMT && argc != BATCH_ARGS_AMT + 1)
+	{
+		std::cerr << "Usage: SpamDetector " << BATCH_FLAG << " [" << EARLY_FLAG
+		          << "] <database path> <message directory or list> <threshold> [threads]\n";
+		return EXIT_FAILURE;
+	}
 	
-	std::ifstream file;
-	file.open(fileName);
-	string key;
-	string temp; // String to read mail into
-	int score = 0; // Spam score of mail
-	
-	/* Read file with two while loops. For every word in mail read from it
-	 * to the end of the mail while adding every word and checking if the
-	 * phrase appears in the database */
-	while(!file.eof())
+	string threshold(argv[4]);
+	string threads(argc > BATCH_ARGS_AMT ? argv[5] : "1");
+	std::error_code error;
+	
+	if(!isValidFile(argv[2]) || !std::filesystem::exists(argv[3], error) || !isValidThreshold(threshold) ||
+	   !isValidThreshold(threads) || !isValidAnyDatabase(argv[2], words))
 	{
-		int location = file.tellg();
-		while(!file.eof())
+		std::cerr << "Invalid input\n";
+		return EXIT_FAILURE;
+	}
+	
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Get the messages of batch mode: the files of a directory sorted by name,
+ * or the paths listed one per line in a file
+ * @param source directory or list of messages
+ * @param paths set to the paths of the messages
+ * @return true if source was read, false if it can't be listed or opened
+ */
+bool batchMessages(const string &source, std::vector<string> &paths)
+{
+	std::error_code error;
+	if(std::filesystem::is_directory(source, error))
+	{
+		std::filesystem::directory_iterator entry(source, error);
+		for(; !error && entry != std::filesystem::directory_iterator(); entry.increment(error))
 		{
-			file >> temp;
-			/* Line is empty */
-			if(temp.length() == 0)
+			/* An entry that can't be inspected is left out like any other non file */
+			std::error_code fileError;
+			if(entry -> is_regular_file(fileError))
 			{
-				break;
+				paths.push_back(entry -> path().string());
 			}
-			
-			temp = lowerCase(temp);
-			
-			/* Remove punctuation marks from start of word */
-			if(temp[0] > 'z' || temp[0] < 'a')
+		}
+		
+		std::sort(paths.begin(), paths.end());
+		return !error;
+	}
+	
+	std::ifstream list(source);
+	if(!list)
+	{
+		return false;
+	}
+	
+	string line;
+	while(std::getline(list, line))
+	{
+		if(!line.empty() && line[line.length() - 1] == '\r')
+		{
+			line = line.substr(0, line.length() - 1);
+		}
+		
+		if(!line.empty())
+		{
+			paths.push_back(line);
+		}
+	}
+	
+	return true;
+}
+
+/**
+ * Score many messages against one database. Worker threads take the next
+ * message in turn, and the calling thread prints "<path> SPAM <score>" or
+ * "<path> NOT_SPAM <score>" for every message in input order, as soon as
+ * it and all messages before it are scored. When stopping early the score
+ * is the one reached when scanning stopped and the line ends with the
+ * offset of the decision (see Verdict). Messages that can't be read print
+ * "<path> INVALID"
+ * @param paths paths of the messages
+ * @param phrases automaton of the bad phrases and their scores
+ * @param threshold threshold for spam score
+ * @param threadAmt amount of worker threads, given after the threshold or
+ * one per core. Never more than one per core or per message are started,
+ * and if none can be started the messages are scored on the calling thread
+ * @param stopEarly true to stop scanning a message once it is spam
+ * @return EXIT_SUCCESS if every message was read, otherwise EXIT_FAILURE
+ */
+int scoreBatch(const std::vector<string> &paths, const AhoCorasick &phrases, int threshold, int threadAmt,
+               bool stopEarly)
+{
+	std::vector<Verdict> verdicts(paths.size(), Verdict{INVALID_SCORE, false, 0});
+	std::vector<bool> done(paths.size(), false);
+	std::atomic<size_t> next(0);
+	std::mutex lock;
+	std::condition_variable scored;
+	
+	auto work = [&]()
+	{
+		for(size_t i = next++; i < paths.size(); i = next++)
+		{
+			/* A message that fails to score, e.g. out of memory, is reported
+			 * like an unreadable one instead of ending the whole batch */
+			Verdict verdict{INVALID_SCORE, false, 0};
+			try
 			{
-				temp = temp.substr(1);
+				if(isValidFile(paths[i]))
+				{
+					verdict = scoreMessage(paths[i], phrases, threshold, stopEarly);
+				}
 			}
-			
-			/* Remove any punctuation marks from end of word */
-			if(temp[temp.length() - 1] > 'z' || temp[temp.length() - 1] < 'a')
+			catch(const std::exception &)
 			{
-				temp = temp.substr(0, temp.length() - 1);
+				verdict = Verdict{INVALID_SCORE, false, 0};
 			}
 			
-			key += (" " + temp);
-			
-			/* Remove unnecessary space added in the first iteration */
-			if(key[0] > 'z' || key[0] < 'a')
 			{
-				key = key.substr(1);
+				std::lock_guard<std::mutex> guard(lock);
+				verdicts[i] = verdict;
+				done[i] = true;
 			}
 			
-			if(words.containsKey(key))
-			{
-				score += words[key];
-				myMap.insert(key, words[key]);
-				key = "";
-				break;
-			}
+			scored.notify_one();
+		}
+	};
+	
+	size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	size_t workerAmt = std::min({(size_t) threadAmt, paths.size(), cores});
+	std::vector<std::thread> workers;
+	try
+	{
+		for(size_t t = 0; t < workerAmt; ++t)
+		{
+			workers.emplace_back(work);
+		}
+	}
+	catch(const std::system_error &)
+	{
+		/* Go on with the workers that did start */
+	}
+	
+	if(workers.empty())
+	{
+		work();
+	}
+	
+	int result = EXIT_SUCCESS;
+	for(size_t i = 0; i < paths.size(); ++i)
+	{
+		Verdict verdict;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			scored.wait(guard, [&]() { return done[i]; });
+			verdict = verdicts[i];
+		}
+		
+		if(verdict.score == INVALID_SCORE)
+		{
+			std::cout << paths[i] << " INVALID\n";
+			result = EXIT_FAILURE;
+			continue;
 		}
 		
-		key = "";
-		file.clear();
-		file.seekg(location, std::ios::beg);
-		file >> temp;
+		std::cout << paths[i] << (verdict.isSpam ? " SPAM " : " NOT_SPAM ") << verdict.score;
+		if(stopEarly)
+		{
+			std::cout << ' ' << verdict.offset;
+		}
+		
+		std::cout << '\n';
 	}
 	
-	file.close();
+	for(std::thread &worker: workers)
+	{
+		worker.join();
+	}
+	
+	std::cout.flush();
+	return result;
+}
+
+/**
+ * Load the phrases of a database
+ * @param fileName database, csv or compiled
+ * @param words words of a csv database, as parsed by isValidDatabase()
+ * @return automaton of the phrases, throws invalidImageException for a
+ * damaged compiled database
+ */
+AhoCorasick loadPhrases(const string &fileName, const HashMap<string, int> &words)
+{
+	if(AhoCorasick::isImageFile(fileName))
+	{
+		return AhoCorasick(fileName);
+	}
+	
+	return AhoCorasick(words);
+}
+
+/**
+ * Validate a csv database and write it compiled, so that later runs map it
+ * instead of parsing it
+ * @param argc amount of arguments supplied
+ * @param argv actual arguments
+ * @return EXIT_SUCCESS if written, otherwise EXIT_FAILURE
+ */
+int compileDatabase(int argc, char **argv)
+{
+	if(argc != COMPILE_ARGS_AMT)
+	{
+		std::cerr << "Usage: SpamDetector " << COMPILE_CMD << " <database path> <output path>\n";
+		return EXIT_FAILURE;
+	}
+	
+	HashMap<string, int> words;
+	if(!isValidFile(argv[2]) || !isValidDatabase(argv[2], words) || !AhoCorasick(words).writeFile(argv[3]))
+	{
+		std::cerr << "Invalid input\n";
+		return EXIT_FAILURE;
+	}
 	
-	return score >= threshold;
+	return EXIT_SUCCESS;
 }
 
 /**
@@ -282,18 +488,75 @@ int main(int argc, char **argv)
 {
 	HashMap<string, int> words;
 
+	if(argc > 1 && string(argv[1]) == COMPILE_CMD)
+	{
+		return compileDatabase(argc, argv);
+	}
+
+	if(argc > 1 && string(argv[1]) == BATCH_FLAG)
+	{
+		/* Drop the early flag, the other arguments keep their indices */
+		bool stopEarly = argc > 2 && string(argv[2]) == EARLY_FLAG;
+		if(stopEarly)
+		{
+			--argc;
+			++argv;
+		}
+
+		if(areValidBatchArgs(argc, argv, words) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+
+		int threshold = 0;
+		int threadAmt = INT_MAX;
+		parseCount(argv[4], threshold);
+		if(argc > BATCH_ARGS_AMT)
+		{
+			parseCount(argv[5], threadAmt);
+		}
+
+		try
+		{
+			AhoCorasick phrases = loadPhrases(argv[2], words);
+			std::vector<string> paths;
+			if(!batchMessages(argv[3], paths))
+			{
+				std::cerr << "Invalid input\n";
+				return EXIT_FAILURE;
+			}
+
+			return scoreBatch(paths, phrases, threshold, threadAmt, stopEarly);
+		}
+		catch(const invalidImageException &)
+		{
+			std::cerr << "Invalid input\n";
+			return EXIT_FAILURE;
+		}
+	}
+
 	if(areValidArgs(argc, argv, words) == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
 
-	if(isSpam(argv[2], words, std::stoi(argv[3])))
+	/* Only the verdict is printed, so the message is read until it is certain */
+	try
 	{
-		std::cout << "SPAM\n";
+		AhoCorasick phrases = loadPhrases(argv[1], words);
+		if(scoreMessage(argv[2], phrases, std::stoi(argv[3]), true).isSpam)
+		{
+			std::cout << "SPAM\n";
+		}
+		else
+		{
+			std::cout << "NOT_SPAM\n";
+		}
 	}
-	else
+	catch(const invalidImageException &)
 	{
-		std::cout << "NOT_SPAM\n";
+		std::cerr << "Invalid input\n";
+		return EXIT_FAILURE;
 	}
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,280 @@
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <sys/mman.h>
+#include "HashMap.hpp"
+#include "FrozenHashMap.hpp"
+#include "AhoCorasick.hpp"
+#include "MessageScorer.hpp"
+
+#define TRUNCATED_BYTES 100
+#define AC_CAPACITY_FIELD 24
+#define AC_EDGES_OFFSET_FIELD 40
+#define WRAPPING_CAPACITY (1ULL << 61)
+#define PAGE_PHRASE_LENGTH 252
+#define PAGE_BYTES 4096
+
+using std::string;
+
+/**
+ * A message with the score the original SpamDetector gave it
+ */
+struct ScoreCase
+{
+	const char *message;
+	int score;
+};
+
+/**
+ * Database of the score cases
+ */
+const pair<const char*, int> PHRASES[] = {{"free money", 3}, {"buy now", 4}, {"winner", 2},
+                                          {"click here now", 5}, {"here", 1}, {"money", 7}};
+
+/**
+ * Scores of the original SpamDetector. A message ending in whitespace counts
+ * its last word once more, see MessageScorer::addTrailingSpace()
+ */
+const ScoreCase SCORE_CASES[] = {{"Free money for you", 10},
+                                 {"FREE money!\n", 17},
+                                 {"buy now buy now", 8},
+                                 {"Click here NOW.", 6},
+                                 {"winner winner\n", 6},
+                                 {"", 0},
+                                 {"nothing to see\n", 0},
+                                 {"(winner) buy\tnow  \n", 6},
+                                 {"here", 1},
+                                 {"here\n", 2},
+                                 {"free\nmoney\n", 17}};
+
+int failures = 0;
+
+/**
+ * Report a failed check
+ * @param passed result of the check
+ * @param what description of the check
+ */
+void check(bool passed, const string &what)
+{
+	if(!passed)
+	{
+		std::cerr << "FAILED: " << what << "\n";
+		failures++;
+	}
+}
+
+/**
+ * Score a message held in memory, word by word as scoreMessage() reads a file
+ * @param phrases automaton of the bad phrases and their scores
+ * @param message text of the message
+ * @return score of the message
+ */
+int scoreText(const AhoCorasick &phrases, const string &message)
+{
+	MessageScorer scorer(phrases);
+	size_t pos = 0;
+	while(true)
+	{
+		while(pos < message.length() && MessageTokenizer::isSpace(message[pos]))
+		{
+			++pos;
+		}
+
+		if(pos == message.length())
+		{
+			break;
+		}
+
+		size_t start = pos;
+		while(pos < message.length() && !MessageTokenizer::isSpace(message[pos]))
+		{
+			++pos;
+		}
+
+		scorer.addWord(std::string_view(message).substr(start, pos - start), true);
+	}
+
+	if(!message.empty() && MessageTokenizer::isSpace(message[message.length() - 1]))
+	{
+		scorer.addTrailingSpace();
+	}
+
+	return scorer.score();
+}
+
+/**
+ * Write bytes to a file
+ * @param fileName path to write to
+ * @param bytes contents of the file
+ */
+void writeBytes(const string &fileName, const string &bytes)
+{
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	file.write(bytes.data(), bytes.size());
+}
+
+/**
+ * Read a whole file
+ * @param fileName path to read
+ * @return contents of the file
+ */
+string readBytes(const string &fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	return string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Check the scores of MessageScorer and scoreMessage() against the original
+ * SpamDetector
+ * @param phrases automaton of PHRASES
+ * @param dir directory for message files
+ * @param label name of the automaton in failure reports
+ */
+void testScores(const AhoCorasick &phrases, const string &dir, const string &label)
+{
+	for(const ScoreCase &test: SCORE_CASES)
+	{
+		string what = label + " score of \"" + test.message + "\"";
+		check(scoreText(phrases, test.message) == test.score, what);
+
+		string fileName = dir + "/message.txt";
+		writeBytes(fileName, test.message);
+		Verdict verdict = scoreMessage(fileName, phrases, test.score + 1, false);
+		check(verdict.score == test.score && !verdict.isSpam, what + " read from a file");
+	}
+}
+
+/**
+ * Round trip a FrozenHashMap through a file, and check that a truncated file
+ * is rejected
+ * @param words map to freeze
+ * @param dir directory for image files
+ */
+void testFrozenHashMap(const HashMap<string, int> &words, const string &dir)
+{
+	string fileName = dir + "/words.frozen";
+	check(FrozenHashMap::writeFile(words, fileName), "write frozen map");
+
+	FrozenHashMap frozen(fileName);
+	check(frozen.size() == words.size(), "frozen map size");
+	for(const auto &item: words)
+	{
+		const int *value = frozen.find(item.first);
+		check(value != nullptr && *value == item.second, "frozen map value of \"" + item.first + "\"");
+	}
+
+	check(frozen.find("not a phrase") == nullptr, "frozen map miss");
+
+	string truncated = dir + "/truncated.frozen";
+	writeBytes(truncated, readBytes(fileName).substr(0, TRUNCATED_BYTES));
+	try
+	{
+		FrozenHashMap rejected(truncated);
+		check(false, "truncated frozen map rejected");
+	}
+	catch(const invalidImageException &)
+	{
+	}
+}
+
+/**
+ * Round trip an AhoCorasick automaton through a file as the compile command
+ * writes it, and check that truncated and crafted files are rejected
+ * @param words phrases to compile
+ * @param dir directory for image and message files
+ */
+void testCompiledPhrases(const HashMap<string, int> &words, const string &dir)
+{
+	string fileName = dir + "/phrases.bin";
+	AhoCorasick built(words);
+	check(built.writeFile(fileName), "write compiled phrases");
+	check(AhoCorasick::isImageFile(fileName), "compiled phrases recognized");
+
+	AhoCorasick loaded(fileName);
+	check(loaded.size() == built.size(), "compiled phrases size");
+	for(const auto &item: words)
+	{
+		const int *value = loaded.find(item.first);
+		check(value != nullptr && *value == item.second, "compiled value of \"" + item.first + "\"");
+	}
+
+	testScores(loaded, dir, "compiled");
+
+	string truncated = dir + "/truncated.bin";
+	writeBytes(truncated, readBytes(fileName).substr(0, TRUNCATED_BYTES));
+	try
+	{
+		AhoCorasick rejected(truncated);
+		check(false, "truncated compiled phrases rejected");
+	}
+	catch(const invalidImageException &)
+	{
+	}
+
+	/* Edges cut off, with a capacity whose size in bytes wraps around to 0. A
+	 * single phrase of PAGE_PHRASE_LENGTH chars has 253 states, which puts
+	 * the edges at PAGE_BYTES, right on a guard page that faults if read */
+	HashMap<string, int> longPhrase;
+	longPhrase.insert(string(PAGE_PHRASE_LENGTH, 'a'), 1);
+	check(AhoCorasick(longPhrase).writeFile(fileName), "write compiled long phrase");
+
+	string image = readBytes(fileName);
+	uint64_t edgesOffset = 0;
+	uint64_t capacity = WRAPPING_CAPACITY;
+	std::memcpy(&edgesOffset, &image[AC_EDGES_OFFSET_FIELD], sizeof(edgesOffset));
+	image.resize(edgesOffset);
+	std::memcpy(&image[AC_CAPACITY_FIELD], &capacity, sizeof(capacity));
+
+	check(image.size() == PAGE_BYTES, "long phrase image fills a page");
+
+	void *pages = mmap(nullptr, 2 * PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	check(pages != MAP_FAILED, "map guarded page");
+	if(pages == MAP_FAILED)
+	{
+		return;
+	}
+
+	std::memcpy(pages, image.data(), image.size());
+	mprotect(static_cast<char*>(pages) + PAGE_BYTES, PAGE_BYTES, PROT_NONE);
+	try
+	{
+		AhoCorasick rejected(pages, image.size());
+		check(false, "compiled phrases with a wrapping capacity rejected");
+	}
+	catch(const invalidImageException &)
+	{
+	}
+
+	munmap(pages, 2 * PAGE_BYTES);
+}
+
+/**
+ * Runs every test, prints failed checks
+ * @return EXIT_SUCCESS if all passed, otherwise EXIT_FAILURE
+ */
+int main()
+{
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / "SpamDetectorTest";
+	std::filesystem::create_directories(dir);
+
+	HashMap<string, int> words;
+	for(const auto &phrase: PHRASES)
+	{
+		words.insert(phrase.first, phrase.second);
+	}
+
+	testScores(AhoCorasick(words), dir.string(), "built");
+	testFrozenHashMap(words, dir.string());
+	testCompiledPhrases(words, dir.string());
+
+	std::filesystem::remove_all(dir);
+	if(failures > 0)
+	{
+		std::cerr << failures << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "All checks passed\n";
+	return EXIT_SUCCESS;
+}
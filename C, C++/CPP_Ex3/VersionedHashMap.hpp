@@ -0,0 +1,376 @@
+#ifndef CPP_EX3_VERSIONEDHASHMAP_HPP
+#define CPP_EX3_VERSIONEDHASHMAP_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "HashMap.hpp"
+
+#define DEF_VERSION_SHARDS 64
+
+/**
+ * HashMap whose readers work on immutable snapshots. Writers change a working
+ * version that nobody else sees, and publish() makes it the version handed
+ * out by snapshot(). A snapshot is a reference counted pointer to a
+ * published version, so taking one is O(1), it stays consistent however long
+ * it is kept, and lookups through it take no locks at all.
+ *
+ * Versions share storage copy-on-write at the level of shards: the key space
+ * is split into shards by the high bits of the key hash (as in
+ * ConcurrentHashMap), each a HashMap, and a version is an array of pointers to
+ * shards. Publishing copies that array, and the first write to a shard after
+ * a publish copies that shard only, leaving the published one untouched.
+ * Writes between two publishes to the same shard pay for a single copy, so
+ * batches of writes, e.g. reloading a dictionary, should be published once
+ * @tparam KeyT type of key
+ * @tparam ValueT type of value
+ * @tparam Hash hash functor for keys
+ * @tparam KeyEqual equality functor for keys
+ */
+template <class KeyT, class ValueT, class Hash = KeyHash<KeyT>, class KeyEqual = std::equal_to<>>
+class VersionedHashMap
+{
+	typedef HashMap<KeyT, ValueT, Hash, KeyEqual> Map;
+
+	/**
+	 * A published version, never changed once published
+	 */
+	struct Version
+	{
+		vector<std::shared_ptr<const Map>> shards;
+		int shardBits;
+		int size;
+		long number;
+	};
+
+	/**
+	 * Enables the lookup overloads taking a key of type K other than KeyT,
+	 * only available when both the hash and the equality are transparent
+	 */
+	template <class K>
+	using heterogeneousKey = typename std::enable_if<isTransparent<Hash>::value &&
+	                                                 isTransparent<KeyEqual>::value &&
+	                                                 !std::is_same<K, KeyT>::value, int>::type;
+
+public:
+	/**
+	 * Read only view of a published version. Safe to use from any thread,
+	 * pointers returned by find() stay valid as long as the snapshot lives
+	 */
+	class Snapshot
+	{
+	public:
+		/**
+		 * Constructor that receives the version to view
+		 * @param version
+		 * @param hasher hash functor the shards were picked with
+		 */
+		Snapshot(std::shared_ptr<const Version> version, const Hash &hasher):
+				_version(std::move(version)),
+				_hasher(hasher)
+		{
+		}
+
+		/**
+		 * Get amount of pairs in the version
+		 * @return
+		 */
+		int size() const
+		{
+			return _version -> size;
+		}
+
+		/**
+		 * Check if the version is empty
+		 * @return true if empty, otherwise false
+		 */
+		bool empty() const
+		{
+			return _version -> size == 0;
+		}
+
+		/**
+		 * Get the number of the version, publish() counts them from 1
+		 * @return
+		 */
+		long version() const
+		{
+			return _version -> number;
+		}
+
+		/**
+		 * Check if the version contains given key
+		 * @param key key to look up
+		 * @return true if key is present, otherwise false
+		 */
+		bool containsKey(const KeyT &key) const
+		{
+			return _shardOf(key).containsKey(key);
+		}
+
+		/**
+		 * Check if the version contains a key equal to key
+		 * @param key key to look up, e.g. a std::string_view for string keys
+		 * @return true if key is present, otherwise false
+		 */
+		template <class K, heterogeneousKey<K> = 0>
+		bool containsKey(const K &key) const
+		{
+			return _shardOf(key).containsKey(key);
+		}
+
+		/**
+		 * Look up the value bound to key
+		 * @param key key to look up
+		 * @return pointer to the value, or nullptr if key not present
+		 */
+		const ValueT* find(const KeyT &key) const
+		{
+			return _shardOf(key).find(key);
+		}
+
+		/**
+		 * Look up the value bound to a key equal to key
+		 * @param key key to look up, e.g. a std::string_view for string keys
+		 * @return pointer to the value, or nullptr if key not present
+		 */
+		template <class K, heterogeneousKey<K> = 0>
+		const ValueT* find(const K &key) const
+		{
+			return _shardOf(key).find(key);
+		}
+
+		/**
+		 * Get value at key. Throws exception if key not present
+		 * @param key key to look up
+		 * @return value bound to key, or exception if key not found
+		 */
+		ValueT at(const KeyT &key) const
+		{
+			return _shardOf(key).at(key);
+		}
+
+		/**
+		 * Call fn on every pair in the version
+		 * @param fn callable taking a const pair<KeyT, ValueT>&
+		 */
+		template <class F>
+		void forEach(F fn) const
+		{
+			for(const std::shared_ptr<const Map> &shard: _version -> shards)
+			{
+				for(auto it = shard -> begin(); it != shard -> end(); ++it)
+				{
+					fn(*it);
+				}
+			}
+		}
+
+	private:
+		/**
+		 * Get the shard of the version holding key
+		 * @param key
+		 * @return
+		 */
+		template <class K>
+		const Map& _shardOf(const K &key) const
+		{
+			return *_version -> shards[_shardIdx(_hasher(key), _version -> shardBits)];
+		}
+
+		std::shared_ptr<const Version> _version;
+		Hash _hasher;
+	};
+
+	/**
+	 * Constructor that receives the amount of shards, publishes an empty
+	 * version
+	 * @param shardAmt amount of shards, rounded up to a power of two
+	 */
+	explicit VersionedHashMap(int shardAmt = DEF_VERSION_SHARDS): _iShardBits(0), _lVersion(0)
+	{
+		while((1 << _iShardBits) < shardAmt)
+		{
+			++_iShardBits;
+		}
+
+		_resetShards();
+		publish();
+	}
+
+	VersionedHashMap(const VersionedHashMap &other) = delete;
+
+	VersionedHashMap& operator=(const VersionedHashMap &other) = delete;
+
+	/**
+	 * Get a snapshot of the last published version. Never blocks on writers
+	 * @return
+	 */
+	Snapshot snapshot() const
+	{
+		return Snapshot(std::atomic_load(&_published), _hasher);
+	}
+
+	/**
+	 * Make the working version, with every write so far, the one handed out
+	 * by snapshot(). O(amount of shards)
+	 */
+	void publish()
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		std::shared_ptr<Version> version = std::make_shared<Version>();
+		version -> shards.assign(_shards.begin(), _shards.end());
+		version -> shardBits = _iShardBits;
+		version -> size = 0;
+		version -> number = ++_lVersion;
+		for(const std::shared_ptr<Map> &shard: _shards)
+		{
+			version -> size += shard -> size();
+		}
+
+		std::atomic_store(&_published, std::shared_ptr<const Version>(std::move(version)));
+
+		/* Every shard is now shared with the published version */
+		_owned.assign(_shards.size(), false);
+	}
+
+	/**
+	 * Get amount of pairs in the working version
+	 * @return
+	 */
+	int size() const
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		int size = 0;
+		for(const std::shared_ptr<Map> &shard: _shards)
+		{
+			size += shard -> size();
+		}
+
+		return size;
+	}
+
+	/**
+	 * Insert given item to the working version
+	 * @param key key of item
+	 * @param value value of item
+	 * @return true if successfully inserted, false if key was already present
+	 */
+	bool insert(KeyT key, ValueT value)
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		return _writable(key).insert(std::move(key), std::move(value));
+	}
+
+	/**
+	 * Bind value to key in the working version, overwriting the current value
+	 * if key is present
+	 * @param key key to assign
+	 * @param value value to bind
+	 * @return true if key was inserted, false if an existing value was assigned
+	 */
+	bool insert_or_assign(const KeyT &key, const ValueT &value)
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		return _writable(key).insert_or_assign(key, value);
+	}
+
+	/**
+	 * Erase value bound to key from the working version
+	 * @param key key to look up
+	 * @return true if value successfully erased, otherwise false
+	 */
+	bool erase(const KeyT &key)
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		return _writable(key).erase(key);
+	}
+
+	/**
+	 * Erase all pairs from the working version. Shards are replaced rather
+	 * than copied and cleared
+	 */
+	void clear()
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		_resetShards();
+	}
+
+	/**
+	 * Replace the working version with the pairs of a range, e.g. a reloaded
+	 * dictionary. Nothing of the previous version is copied
+	 * @param first iterator to the first pair
+	 * @param last iterator past the last pair
+	 */
+	template <class InputIt>
+	void assign(InputIt first, InputIt last)
+	{
+		std::lock_guard<std::mutex> guard(_writeLock);
+		_resetShards();
+		for(; first != last; ++first)
+		{
+			_shards[_shardIdx(_hasher(first -> first), _iShardBits)] -> insert_or_assign(first -> first,
+			                                                                          first -> second);
+		}
+	}
+
+private:
+	/**
+	 * Pick the shard of a hash from its high bits. The shard maps index
+	 * their buckets by the low bits, so the two don't correlate
+	 * @param hash hash of a key
+	 * @param shardBits log2 of the amount of shards
+	 * @return
+	 */
+	static size_t _shardIdx(size_t hash, int shardBits)
+	{
+		if(shardBits == 0)
+		{
+			return 0;
+		}
+
+		return ((uint64_t) hash * 0x9E3779B97F4A7C15ULL) >> (64 - shardBits);
+	}
+
+	/**
+	 * Replace every shard with a new empty one owned by the working version
+	 */
+	void _resetShards()
+	{
+		_shards.clear();
+		for(int i = 0; i < (1 << _iShardBits); ++i)
+		{
+			_shards.push_back(std::make_shared<Map>());
+		}
+
+		_owned.assign(_shards.size(), true);
+	}
+
+	/**
+	 * Get the shard of the working version holding key, copying it first if
+	 * it is still shared with a published version
+	 * @param key
+	 * @return
+	 */
+	Map& _writable(const KeyT &key)
+	{
+		size_t idx = _shardIdx(_hasher(key), _iShardBits);
+		if(!_owned[idx])
+		{
+			_shards[idx] = std::make_shared<Map>(*_shards[idx]);
+			_owned[idx] = true;
+		}
+
+		return *_shards[idx];
+	}
+
+	Hash _hasher;
+	int _iShardBits;
+	long _lVersion;
+	vector<std::shared_ptr<Map>> _shards;
+	vector<bool> _owned;
+	std::shared_ptr<const Version> _published;
+	mutable std::mutex _writeLock;
+};
+
+#endif //CPP_EX3_VERSIONEDHASHMAP_HPP